@@ -0,0 +1,325 @@
+/*  Benchmark harness for the Boolean Propagation Solver and SillyCon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Usage:
+
+    bench [-r repeats] [-o outfile] [-b baselinefile] [-t threshold] [-c] workloadfile
+
+Runs every workload in the workload file, and reports the wall clock time
+(median of repeats), the number of propagations, choices and solutions
+(summed over all solvers that print them), propagations per second,
+solutions per second, the number of variables and rules of the largest 
+problem, and peak resident set size.
+
+The results are written in JSON format to outfile (default stdout), with
+one workload per line. A summary table is printed on stderr.
+
+If a baseline file (the output of a previous run) is given, the wall clock
+times are compared with the baseline. A workload that is more than threshold
+percent (default 10) slower than in the baseline is reported as a regression,
+and the program exits with status 1.
+
+With -c, the solvers read hardware performance counters (the environment
+variable BPS_PERF_COUNTERS is set, see EnablePerfCounters in bps.h), and the
+cycles, instructions, cache misses, branch misses and page faults they print
+are reported too. Counters that are not available are reported as zero.
+Reading the counters slows down the solvers, so do not compare these times
+with a baseline without -c.
+
+Workload file format, one workload per line:
+
+    name program inputfile
+
+Blank lines and lines starting with # are ignored. The program is run with
+the input file as argument, and with stdin from /dev/null.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define MAX_WORKLOADS   256
+#define MAX_LINE        1024
+#define MAX_NAME        64
+#define MIN_SECONDS     0.01        // faster workloads are too noisy to compare
+
+typedef struct {
+    char name[MAX_NAME];
+    char program[MAX_LINE];
+    char input[MAX_LINE];
+    // results
+    int status;             // exit status, or -1 if not run
+    double seconds;         // wall clock time (median of repeats)
+    long propagations;
+    long choices;
+    long solutions;
+    long variables;         // largest problem solved
+    long rules;
+    long peakrss;           // peak resident set size in kilobytes
+    // performance counters (with -c)
+    long cycles;
+    long instructions;
+    long cachemisses;
+    long branchmisses;
+    long pagefaults;
+} Workload;
+
+Workload gWorkloads[MAX_WORKLOADS];
+int gNumberOfWorkloads = 0;
+
+// monotonic wall clock time in seconds
+double WallTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec) * 1e-9;
+}
+
+// reads the workload file; returns zero on failure
+int ReadWorkloads(char* filename) {
+    FILE* file = fopen(filename, "rt");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open file %s\n", filename);
+        return 0;
+    }
+    char line[MAX_LINE];
+    while (fgets(line, MAX_LINE, file) != NULL) {
+        char* start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        if (*start == '#' || *start == '\n' || *start == 0) continue;
+        if (gNumberOfWorkloads >= MAX_WORKLOADS) {
+            fprintf(stderr, "too many workloads; max %d\n", MAX_WORKLOADS);
+            break;
+        }
+        Workload* w = &gWorkloads[gNumberOfWorkloads];
+        memset(w, 0, sizeof(Workload));
+        if (sscanf(start, "%63s %1023s %1023s", w->name, w->program, w->input) != 3) {
+            fprintf(stderr, "ignored workload: %s", line);
+            continue;
+        }
+        w->status = -1;
+        gNumberOfWorkloads++;
+    }
+    fclose(file);
+    return 1;
+}
+
+// adds the statistics that a solver prints in a line of output
+void ParseOutputLine(Workload* w, char* line) {
+    long number;
+    char word[32];
+    // the test program prints the problem size as "number of variables = 10"
+    if (sscanf(line, "number of %31s = %ld", word, &number) == 2) {
+        if (strcmp(word, "variables") == 0 && number > w->variables) w->variables = number;
+        if (strcmp(word, "rules") == 0 && number > w->rules) w->rules = number;
+        return;
+    }
+    if (sscanf(line, "%ld %31s", &number, word) != 2) return;
+    if (strcmp(word, "variables") == 0 && number > w->variables) w->variables = number;
+    else if (strcmp(word, "rules") == 0 && number > w->rules) w->rules = number;
+    else if (strcmp(word, "propagations") == 0) w->propagations += number;
+    else if (strcmp(word, "choices") == 0) w->choices += number;
+    else if (strcmp(word, "solutions") == 0) w->solutions += number;
+    else if (strcmp(word, "cycles") == 0) w->cycles += number;
+    else if (strcmp(word, "instructions") == 0) w->instructions += number;
+    else if (strcmp(word, "cache-misses") == 0) w->cachemisses += number;
+    else if (strcmp(word, "branch-misses") == 0) w->branchmisses += number;
+    else if (strcmp(word, "page-faults") == 0) w->pagefaults += number;
+}
+
+// runs a workload once; returns the wall clock time, or a negative value on failure
+double RunWorkload(Workload* w) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1.0;
+    double start = WallTime();
+    pid_t pid = fork();
+    if (pid < 0) return -1.0;
+    if (pid == 0) {
+        // child: stdout to pipe, stdin from /dev/null
+        int devnull = open("/dev/null", O_RDONLY);
+        if (devnull >= 0) dup2(devnull, 0);
+        dup2(fds[1], 1);
+        close(fds[0]);
+        close(fds[1]);
+        execl(w->program, w->program, w->input, (char*)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    // statistics of this run only
+    w->propagations = 0;
+    w->choices = 0;
+    w->solutions = 0;
+    w->variables = 0;
+    w->rules = 0;
+    w->cycles = 0;
+    w->instructions = 0;
+    w->cachemisses = 0;
+    w->branchmisses = 0;
+    w->pagefaults = 0;
+    FILE* output = fdopen(fds[0], "r");
+    char line[MAX_LINE];
+    while (fgets(line, MAX_LINE, output) != NULL) {
+        ParseOutputLine(w, line);
+    }
+    fclose(output);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) return -1.0;
+    double seconds = WallTime() - start;
+    if (usage.ru_maxrss > w->peakrss) w->peakrss = usage.ru_maxrss;
+    w->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return seconds;
+}
+
+int CompareDoubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// per second, or zero if no time was measured
+double PerSecond(long count, double seconds) {
+    return seconds > 0 ? count / seconds : 0.0;
+}
+
+void WriteResults(FILE* file) {
+    int i;
+    fprintf(file, "{\"workloads\": [\n");
+    for (i=0;i<gNumberOfWorkloads;i++) {
+        Workload* w = &gWorkloads[i];
+        fprintf(file, "{\"name\": \"%s\", \"seconds\": %.6f, \"propagations\": %ld, \"choices\": %ld, "
+                "\"solutions\": %ld, \"propagations_per_second\": %.1f, \"solutions_per_second\": %.3f, "
+                "\"variables\": %ld, \"rules\": %ld, \"peak_rss_kb\": %ld, \"cycles\": %ld, \"instructions\": %ld, "
+                "\"cache_misses\": %ld, \"branch_misses\": %ld, \"page_faults\": %ld, \"status\": %d}%s\n",
+                w->name, w->seconds, w->propagations, w->choices, w->solutions,
+                PerSecond(w->propagations, w->seconds), PerSecond(w->solutions, w->seconds),
+                w->variables, w->rules, w->peakrss, w->cycles, w->instructions, 
+                w->cachemisses, w->branchmisses, w->pagefaults, w->status, i < gNumberOfWorkloads-1 ? "," : "");
+    }
+    fprintf(file, "]}\n");
+}
+
+// compares with the results in a baseline file (written by WriteResults)
+// returns the number of regressions
+int CompareBaseline(char* filename, double threshold) {
+    FILE* file = fopen(filename, "rt");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open baseline %s\n", filename);
+        return 0;
+    }
+    int regressions = 0;
+    char line[MAX_LINE];
+    fprintf(stderr, "\n%-20s %12s %12s %8s\n", "compared", "baseline", "seconds", "change");
+    while (fgets(line, MAX_LINE, file) != NULL) {
+        char name[MAX_NAME];
+        double seconds;
+        long propagations;
+        if (sscanf(line, "{\"name\": \"%63[^\"]\", \"seconds\": %lf, \"propagations\": %ld",
+                   name, &seconds, &propagations) != 3) continue;
+        int i;
+        for (i=0;i<gNumberOfWorkloads;i++) {
+            Workload* w = &gWorkloads[i];
+            if (strcmp(w->name, name) != 0 || w->status != 0) continue;
+            double change = seconds > 0 ? 100.0 * (w->seconds - seconds) / seconds : 0.0;
+            int regression = (change > threshold && w->seconds >= MIN_SECONDS);
+            fprintf(stderr, "%-20s %12.6f %12.6f %+7.1f%%%s%s\n", name, seconds, w->seconds, change,
+                    regression ? "  REGRESSION" : "",
+                    propagations != w->propagations ? "  (search changed)" : "");
+            regressions += regression;
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    int repeats = 3;
+    char* outfilename = NULL;
+    char* baselinefilename = NULL;
+    double threshold = 10.0;
+    int counters = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:o:b:t:c")) != -1) {
+        switch (opt) {
+            case 'r': repeats = atoi(optarg); break;
+            case 'o': outfilename = optarg; break;
+            case 'b': baselinefilename = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            case 'c': counters = 1; break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc-1 || repeats < 1) {
+        fprintf(stderr, "usage: %s [-r repeats] [-o outfile] [-b baselinefile] [-t threshold] [-c] workloadfile\n", argv[0]);
+        return 2;
+    }
+    if (!ReadWorkloads(argv[optind])) return 2;
+    // the workloads inherit the environment
+    if (counters) setenv("BPS_PERF_COUNTERS", "1", 1);
+
+    // run
+    fprintf(stderr, "%-20s %12s %14s %10s %10s %14s %10s\n",
+            "workload", "seconds", "propagations", "choices", "solutions", "props/s", "rss(kB)");
+    double* times = (double*)malloc(repeats*sizeof(double));
+    int i,r;
+    for (i=0;i<gNumberOfWorkloads;i++) {
+        Workload* w = &gWorkloads[i];
+        for (r=0;r<repeats;r++) {
+            times[r] = RunWorkload(w);
+            if (times[r] < 0 || w->status != 0) break;
+        }
+        if (r < repeats) {
+            fprintf(stderr, "%-20s failed (status %d)\n", w->name, w->status);
+            if (w->status == 0) w->status = -1;
+            continue;
+        }
+        qsort(times, repeats, sizeof(double), CompareDoubles);
+        w->seconds = times[repeats/2];
+        fprintf(stderr, "%-20s %12.6f %14ld %10ld %10ld %14.0f %10ld\n", w->name, w->seconds,
+                w->propagations, w->choices, w->solutions, PerSecond(w->propagations, w->seconds), w->peakrss);
+        if (counters) {
+            fprintf(stderr, "%-20s %ld cycles, %ld instructions, %ld cache misses, %ld branch misses, %ld page faults\n", "",
+                    w->cycles, w->instructions, w->cachemisses, w->branchmisses, w->pagefaults);
+        }
+    }
+    free(times);
+
+    // report
+    FILE* outfile = stdout;
+    if (outfilename != NULL) {
+        outfile = fopen(outfilename, "wt");
+        if (outfile == NULL) {
+            fprintf(stderr, "failed to open file %s\n", outfilename);
+            return 2;
+        }
+    }
+    WriteResults(outfile);
+    if (outfile != stdout) fclose(outfile);
+
+    if (baselinefilename != NULL) {
+        int regressions = CompareBaseline(baselinefilename, threshold);
+        if (regressions > 0) {
+            fprintf(stderr, "%d regressions (threshold %.1f%%)\n", regressions, threshold);
+            return 1;
+        }
+    }
+    return 0;
+}
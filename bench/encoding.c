@@ -0,0 +1,299 @@
+/*  Encoding size suite for the SillyCon operators
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Usage:
+
+    encoding [-w widths] [-o outfile] [-b baselinefile] suitefile
+
+Compiles every expression in the suite file with convertExpr, for each
+number width in the comma separated list widths (default 4,9,12), and
+reports the size of the encoding: the number of literals, the number of
+rules and the average lhs and rhs size, before and after Simplify.
+
+The results are written in JSON format to outfile (default stdout), with
+one expression and width per line. A summary table is printed on stderr.
+
+If a baseline file (the output of a previous run) is given, the sizes are
+compared with the baseline. An encoding with more literals or rules than in
+the baseline, before or after Simplify, is reported as a regression, and the
+program exits with status 1.
+
+Suite file format, one expression per line:
+
+    name expression
+
+Blank lines and lines starting with # are ignored. The expression is in the
+SillyCon language and is not implicitly constrained.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bps.h"
+#include "sillycon.h"
+
+#define MAX_EXPRESSIONS 256
+#define MAX_WIDTHS      16
+#define MAX_LINE        1024
+#define MAX_NAME        64
+
+typedef struct {
+    long literals;
+    long rules;
+    double lhs;             // average number of literals in lhs
+    double rhs;             // average number of literals in rhs
+} Size;
+
+typedef struct {
+    char name[MAX_NAME];
+    char expression[MAX_LINE];
+    int width;
+    // results
+    int status;             // zero if compiled
+    Size size;              // as compiled by convertExpr
+    Size simplified;        // after Simplify
+} Encoding;
+
+Encoding gEncodings[MAX_EXPRESSIONS*MAX_WIDTHS];
+int gNumberOfEncodings = 0;
+
+int gWidths[MAX_WIDTHS] = {4, 9, 12};
+int gNumberOfWidths = 3;
+
+// parses a comma separated list of widths; returns zero on failure
+int ParseWidths(char* list) {
+    gNumberOfWidths = 0;
+    char* token = strtok(list, ",");
+    while (token != NULL) {
+        int width = atoi(token);
+        if (width < 2 || width > 31 || gNumberOfWidths >= MAX_WIDTHS) return 0;
+        gWidths[gNumberOfWidths++] = width;
+        token = strtok(NULL, ",");
+    }
+    return gNumberOfWidths > 0;
+}
+
+// reads the suite file, one encoding per expression and width; returns zero on failure
+int ReadSuite(char* filename) {
+    FILE* file = fopen(filename, "rt");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open file %s\n", filename);
+        return 0;
+    }
+    char line[MAX_LINE];
+    while (fgets(line, MAX_LINE, file) != NULL) {
+        char* start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        if (*start == '#' || *start == '\n' || *start == 0) continue;
+        char name[MAX_NAME];
+        int length;
+        if (sscanf(start, "%63s %n", name, &length) != 1 || start[length] == 0) {
+            fprintf(stderr, "ignored expression: %s", line);
+            continue;
+        }
+        int i;
+        for (i=0;i<gNumberOfWidths;i++) {
+            if (gNumberOfEncodings >= MAX_EXPRESSIONS*MAX_WIDTHS) {
+                fprintf(stderr, "too many expressions; max %d\n", MAX_EXPRESSIONS);
+                fclose(file);
+                return 1;
+            }
+            Encoding* e = &gEncodings[gNumberOfEncodings++];
+            memset(e, 0, sizeof(Encoding));
+            strncpy(e->name, name, MAX_NAME);
+            strncpy(e->expression, start+length, MAX_LINE-1);
+            e->expression[strcspn(e->expression, "\n")] = 0;
+            e->width = gWidths[i];
+            e->status = -1;
+        }
+    }
+    fclose(file);
+    return 1;
+}
+
+// size of the rules of a problem
+void MeasureProblem(Problem* p, Size* size) {
+    long lhs = 0;
+    long rhs = 0;
+    size->literals = p->maxlit;
+    size->rules = 0;
+    int* values = p->rules->values;
+    int pos = 0;
+    while (pos < p->rules->count) {
+        for (;pos < p->rules->count && values[pos] != 0;pos++) lhs++;
+        pos++;
+        for (;pos < p->rules->count && values[pos] != 0;pos++) rhs++;
+        pos++;
+        size->rules++;
+    }
+    size->lhs = size->rules > 0 ? (double)lhs / size->rules : 0.0;
+    size->rhs = size->rules > 0 ? (double)rhs / size->rules : 0.0;
+}
+
+// compiles and simplifies an encoding; sets its status
+void CompileEncoding(Encoding* e) {
+    gNumberWidth = e->width;
+    Lexer* input = newStringLexer(e->expression, strlen(e->expression));
+    Expr* expr = parseExpr(input);
+    deleteLexer(input);
+    if (expr == NULL) {
+        deleteExprs();
+        return;
+    }
+    // as in main
+    int eliminated = 0;
+    expr = rewriteExpr(expr, &eliminated);
+    Problem* problem = newProblem();
+    List* literals = convertExpr(expr, problem);
+    if (literals == NULL) {
+        deleteProblem(problem);
+        deleteExprs();
+        return;
+    }
+    MeasureProblem(problem, &e->size);
+    // as in main: all variables are in the problem
+    addRule2(problem, 0,0, problem->maxlit, 0);
+    Problem* simplified = Simplify(problem, literals);
+    MeasureProblem(simplified, &e->simplified);
+    deleteProblem(simplified);
+    deleteProblem(problem);
+    DeleteList(literals);
+    deleteExprs();
+    e->status = 0;
+}
+
+void WriteResults(FILE* file) {
+    int i;
+    fprintf(file, "{\"encodings\": [\n");
+    for (i=0;i<gNumberOfEncodings;i++) {
+        Encoding* e = &gEncodings[i];
+        fprintf(file, "{\"name\": \"%s\", \"width\": %d, \"literals\": %ld, \"rules\": %ld, "
+                "\"average_lhs\": %.3f, \"average_rhs\": %.3f, \"simplified_literals\": %ld, "
+                "\"simplified_rules\": %ld, \"simplified_average_lhs\": %.3f, \"simplified_average_rhs\": %.3f, "
+                "\"status\": %d}%s\n",
+                e->name, e->width, e->size.literals, e->size.rules, e->size.lhs, e->size.rhs,
+                e->simplified.literals, e->simplified.rules, e->simplified.lhs, e->simplified.rhs,
+                e->status, i < gNumberOfEncodings-1 ? "," : "");
+    }
+    fprintf(file, "]}\n");
+}
+
+// compares with the results in a baseline file (written by WriteResults)
+// returns the number of regressions
+int CompareBaseline(char* filename) {
+    FILE* file = fopen(filename, "rt");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open baseline %s\n", filename);
+        return 0;
+    }
+    int regressions = 0;
+    int compared = 0;
+    char line[MAX_LINE];
+    fprintf(stderr, "\n%-12s %5s %17s %17s %17s %17s\n", "compared", "width",
+            "literals", "rules", "simplified lits", "simplified rules");
+    while (fgets(line, MAX_LINE, file) != NULL) {
+        char name[MAX_NAME];
+        int width;
+        Size size, simplified;
+        if (sscanf(line, "{\"name\": \"%63[^\"]\", \"width\": %d, \"literals\": %ld, \"rules\": %ld, "
+                   "\"average_lhs\": %lf, \"average_rhs\": %lf, \"simplified_literals\": %ld, "
+                   "\"simplified_rules\": %ld", name, &width, &size.literals, &size.rules, &size.lhs,
+                   &size.rhs, &simplified.literals, &simplified.rules) != 8) continue;
+        int i;
+        for (i=0;i<gNumberOfEncodings;i++) {
+            Encoding* e = &gEncodings[i];
+            if (strcmp(e->name, name) != 0 || e->width != width || e->status != 0) continue;
+            compared++;
+            int regression = e->size.literals > size.literals || e->size.rules > size.rules
+                || e->simplified.literals > simplified.literals || e->simplified.rules > simplified.rules;
+            int changed = e->size.literals != size.literals || e->size.rules != size.rules
+                || e->simplified.literals != simplified.literals || e->simplified.rules != simplified.rules;
+            // only changes are listed
+            if (!changed) continue;
+            fprintf(stderr, "%-12s %5d %8ld->%-8ld %8ld->%-8ld %8ld->%-8ld %8ld->%-8ld%s\n", name, width,
+                    size.literals, e->size.literals, size.rules, e->size.rules,
+                    simplified.literals, e->simplified.literals, simplified.rules, e->simplified.rules,
+                    regression ? "  REGRESSION" : "");
+            regressions += regression;
+        }
+    }
+    fclose(file);
+    fprintf(stderr, "%d encodings compared\n", compared);
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    char* outfilename = NULL;
+    char* baselinefilename = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:o:b:")) != -1) {
+        switch (opt) {
+            case 'w': if (!ParseWidths(optarg)) optind = argc + 1; break;
+            case 'o': outfilename = optarg; break;
+            case 'b': baselinefilename = optarg; break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if (optind != argc-1) {
+        fprintf(stderr, "usage: %s [-w widths] [-o outfile] [-b baselinefile] suitefile\n", argv[0]);
+        return 2;
+    }
+    if (!ReadSuite(argv[optind])) return 2;
+
+    // compile, quietly
+    gVerbose = FALSE;
+    fprintf(stderr, "%-12s %5s %9s %9s %6s %6s %11s %11s %6s %6s\n", "expression", "width",
+            "literals", "rules", "lhs", "rhs", "simp. lits", "simp. rules", "lhs", "rhs");
+    int failures = 0;
+    int i;
+    for (i=0;i<gNumberOfEncodings;i++) {
+        Encoding* e = &gEncodings[i];
+        CompileEncoding(e);
+        if (e->status != 0) {
+            fprintf(stderr, "%-12s %5d failed: %s\n", e->name, e->width, e->expression);
+            failures++;
+            continue;
+        }
+        fprintf(stderr, "%-12s %5d %9ld %9ld %6.2f %6.2f %11ld %11ld %6.2f %6.2f\n", e->name, e->width,
+                e->size.literals, e->size.rules, e->size.lhs, e->size.rhs,
+                e->simplified.literals, e->simplified.rules, e->simplified.lhs, e->simplified.rhs);
+    }
+    // warnings of the encoders come before the results
+    fflush(stdout);
+
+    // report
+    FILE* outfile = stdout;
+    if (outfilename != NULL) {
+        outfile = fopen(outfilename, "wt");
+        if (outfile == NULL) {
+            fprintf(stderr, "failed to open file %s\n", outfilename);
+            return 2;
+        }
+    }
+    WriteResults(outfile);
+    if (outfile != stdout) fclose(outfile);
+
+    if (baselinefilename != NULL) {
+        int regressions = CompareBaseline(baselinefilename);
+        if (regressions > 0) {
+            fprintf(stderr, "%d regressions\n", regressions);
+            return 1;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
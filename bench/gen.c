@@ -0,0 +1,275 @@
+/*  Workload generator for the Boolean Propagation Solver and SillyCon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Usage:
+
+    gen random <variables> <k> <ratio> <seed>      (.prop)
+    gen pigeonhole <pigeons> <holes> <seed>         (.prop)
+    gen table <n> <seed>                            (.silly)
+    gen triangle <bound> <seed>                     (.silly)
+    gen adders <n> <bound> <seed>                   (.silly)
+    gen factor <bound> <seed>                       (.silly)
+    gen chain <n> <seed>                            (.silly)
+
+Writes a generated problem to stdout. The same arguments and seed always
+give the same problem.
+
+random:     ratio*variables rules, each with k random input literals and one
+            random output literal.
+pigeonhole: every pigeon in exactly one hole, at most one pigeon per hole;
+            no solutions if there are more pigeons than holes. The seed
+            shuffles the rules.
+table:      an n by n table of products, like examples/table.silly, with
+            a random offset.
+triangle:   Pythagorean triples with sides below bound, one of which is a
+            random number, like examples/triangle_search.silly.
+adders:     n variables below bound that add up to a random sum; a chain
+            of n-1 adders.
+factor:     two factors, both at least 2, of the product of two random
+            numbers below bound.
+chain:      a chain of & with n operands that fix a variable to a random 
+            digit, and a random one of them repeated at the start and the
+            end. The rewrite pass removes the duplicates only if the chain
+            fits in its buffer (see MAX_CHAIN in sillycon.c). One solution.
+
+Note that SillyCon numbers are 9 bit two's complement numbers, so large
+bounds make arithmetic wrap around.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// random number generator with a fixed sequence for each seed (xorshift)
+unsigned int gRandomState = 1;
+
+void SeedRandom(unsigned int seed) {
+    gRandomState = seed * 2654435761u + 1;
+    if (gRandomState == 0) gRandomState = 1;
+}
+
+// random number 0 <= r < n
+int Random(int n) {
+    unsigned int x = gRandomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gRandomState = x;
+    return (int)(x % (unsigned int)n);
+}
+
+// random literal of a variable 1..n
+int RandomLiteral(int n) {
+    int var = Random(n) + 1;
+    return Random(2) ? var : -var;
+}
+
+// ------------- .prop workloads -----------
+
+void GenerateRandom(int numvars, int k, double ratio) {
+    int numrules = (int)(ratio * numvars + 0.5);
+    int* lhs = (int*)malloc(k*sizeof(int));
+    int r,i,j;
+    for (r=0;r<numrules;r++) {
+        // distinct variables in lhs (duplicates are not supported by the solver)
+        for (i=0;i<k;i++) {
+            int again = 1;
+            while (again) {
+                lhs[i] = RandomLiteral(numvars);
+                again = 0;
+                for (j=0;j<i;j++) if (abs(lhs[j]) == abs(lhs[i])) again = 1;
+            }
+            printf("%d ", lhs[i]);
+        }
+        printf("0 %d 0\n", RandomLiteral(numvars));
+    }
+    // all variables are in the problem
+    printf("%d 0 %d 0\n", numvars, numvars);
+    printf("0 0\n");
+    free(lhs);
+}
+
+typedef struct {
+    int* lhs;
+    int numlhs;
+    int rhs;
+} GenRule;
+
+void GeneratePigeonhole(int pigeons, int holes) {
+    // variable of pigeon p in hole h
+    #define PH(p,h) ((p)*holes+(h)+1)
+    int maxrules = pigeons*holes*(pigeons+holes);
+    GenRule* rules = (GenRule*)malloc(maxrules*sizeof(GenRule));
+    int n = 0;
+    int p,h,q;
+    for (p=0;p<pigeons;p++) {
+        for (h=0;h<holes;h++) {
+            // no other hole for this pigeon
+            for (q=0;q<holes;q++) {
+                if (q == h) continue;
+                rules[n].lhs = (int*)malloc(sizeof(int));
+                rules[n].lhs[0] = PH(p,h);
+                rules[n].numlhs = 1;
+                rules[n].rhs = -PH(p,q);
+                n++;
+            }
+            // no other pigeon in this hole
+            for (q=0;q<pigeons;q++) {
+                if (q == p) continue;
+                rules[n].lhs = (int*)malloc(sizeof(int));
+                rules[n].lhs[0] = PH(p,h);
+                rules[n].numlhs = 1;
+                rules[n].rhs = -PH(q,h);
+                n++;
+            }
+            // this hole if no other hole
+            if (holes > 1) {
+                rules[n].lhs = (int*)malloc((holes-1)*sizeof(int));
+                rules[n].numlhs = 0;
+                for (q=0;q<holes;q++) {
+                    if (q != h) rules[n].lhs[rules[n].numlhs++] = -PH(p,q);
+                }
+                rules[n].rhs = PH(p,h);
+                n++;
+            }
+        }
+    }
+    // shuffle
+    int i;
+    for (i=n-1;i>0;i--) {
+        int j = Random(i+1);
+        GenRule tmp = rules[i];
+        rules[i] = rules[j];
+        rules[j] = tmp;
+    }
+    for (i=0;i<n;i++) {
+        int l;
+        for (l=0;l<rules[i].numlhs;l++) printf("%d ", rules[i].lhs[l]);
+        printf("0 %d 0\n", rules[i].rhs);
+        free(rules[i].lhs);
+    }
+    // all variables are in the problem, including a single hole
+    printf("%d 0 %d 0\n", PH(pigeons-1,holes-1), PH(pigeons-1,holes-1));
+    printf("0 0\n");
+    free(rules);
+    #undef PH
+}
+
+// ------------- .silly workloads -----------
+
+void GenerateTable(int n) {
+    int offset = Random(n+1);
+    printf("\"a %d by %d table of values: v_%d*i+j+%d = v_i * v_j with 0 < i,j <= %d\"\n\n", n, n, n, offset+1, n);
+    printf("`=k*?i?j\n");
+    printf("&=n%d\n", n);
+    printf(" &!<i0\n");
+    printf("  &<in\n");
+    printf("   &!<j0\n");
+    printf("    &<jn\n");
+    printf("     =k+%d+*inj\n", 1+offset);
+}
+
+void GenerateTriangle(int bound) {
+    int k = 3 + Random(bound > 3 ? bound-3 : 1);
+    printf("\" Pythagorean right triangles with sides below %d, and a side %d\"\n", bound, k);
+    printf("& < 0 x\n");
+    printf("& < 0 y\n");
+    printf("& < 0 z\n");
+    printf("& < x y\n");
+    printf("& < z %d\n", bound);
+    printf("&  = * z z\n");
+    printf("     + * x x * y y\n");
+    printf("& | =x k\n");
+    printf("  | =y k\n");
+    printf("    =z k\n");
+    printf("= k %d\n", k);
+}
+
+void GenerateAdders(int n, int bound) {
+    int sum = Random(n*(bound-1)+1);
+    printf("\" %d variables below %d with sum %d\"\n", n, bound, sum);
+    int i;
+    for (i=1;i<=n;i++) {
+        printf("& ! < ?%d 0\n", i);
+        printf("& < ?%d %d\n", i, bound);
+    }
+    printf("= %d ", sum);
+    for (i=1;i<n;i++) printf("+ ?%d ", i);
+    printf("?%d\n", n);
+}
+
+void GenerateFactor(int bound) {
+    int a = 2 + Random(bound > 2 ? bound-2 : 1);
+    int b = 2 + Random(bound > 2 ? bound-2 : 1);
+    printf("\" factors of %d (%d*%d)\"\n", a*b, a, b);
+    printf("& < 1 x\n");
+    printf("& < 1 y\n");
+    printf("& ! < y x\n");
+    printf("= %d * x y\n", a*b);
+}
+
+void GenerateChain(int n) {
+    int* digits = (int*)malloc(n*sizeof(int));
+    int repeated = 1 + Random(n);
+    int i;
+    int digit = Random(10);
+    for (i=0;i<n;i++) digits[i] = Random(10);
+    digits[repeated-1] = digit;
+    printf("\" a chain of %d operands; ?%d = %d is repeated at the start and the end\"\n", n+2, repeated, digit);
+    printf("& = ?%d %d\n", repeated, digit);
+    for (i=1;i<=n;i++) printf("& = ?%d %d\n", i, digits[i-1]);
+    printf("= ?%d %d\n", repeated, digit);
+    free(digits);
+}
+
+void Usage(char* program) {
+    fprintf(stderr, "usage: %s random <variables> <k> <ratio> <seed>\n", program);
+    fprintf(stderr, "       %s pigeonhole <pigeons> <holes> <seed>\n", program);
+    fprintf(stderr, "       %s table <n> <seed>\n", program);
+    fprintf(stderr, "       %s triangle <bound> <seed>\n", program);
+    fprintf(stderr, "       %s adders <n> <bound> <seed>\n", program);
+    fprintf(stderr, "       %s factor <bound> <seed>\n", program);
+    fprintf(stderr, "       %s chain <n> <seed>\n", program);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        Usage(argv[0]);
+        return 2;
+    }
+    char* kind = argv[1];
+    // the seed is the last argument
+    SeedRandom((unsigned int)atoi(argv[argc-1]));
+    if (strcmp(kind, "random") == 0 && argc == 6 && atoi(argv[2]) > 0 && atoi(argv[3]) > 0 && atoi(argv[3]) <= atoi(argv[2]))
+        GenerateRandom(atoi(argv[2]), atoi(argv[3]), atof(argv[4]));
+    else if (strcmp(kind, "pigeonhole") == 0 && argc == 5 && atoi(argv[2]) > 0 && atoi(argv[3]) > 0)
+        GeneratePigeonhole(atoi(argv[2]), atoi(argv[3]));
+    else if (strcmp(kind, "table") == 0 && argc == 4 && atoi(argv[2]) > 0)
+        GenerateTable(atoi(argv[2]));
+    else if (strcmp(kind, "triangle") == 0 && argc == 4 && atoi(argv[2]) > 0)
+        GenerateTriangle(atoi(argv[2]));
+    else if (strcmp(kind, "adders") == 0 && argc == 5 && atoi(argv[2]) > 0 && atoi(argv[3]) > 0)
+        GenerateAdders(atoi(argv[2]), atoi(argv[3]));
+    else if (strcmp(kind, "factor") == 0 && argc == 4 && atoi(argv[2]) > 0)
+        GenerateFactor(atoi(argv[2]));
+    else if (strcmp(kind, "chain") == 0 && argc == 4 && atoi(argv[2]) > 0)
+        GenerateChain(atoi(argv[2]));
+    else {
+        Usage(argv[0]);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,353 @@
+/*  Microbenchmarks for the Boolean Propagation Solver
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Usage:
+
+    micro [-r repetitions] [-n size] [name]
+
+Runs each microbenchmark (or only the named one) for a number of repetitions
+and prints the minimum, median, mean and standard deviation of the time per
+operation in nanoseconds, and the number of allocations per operation.
+
+Allocations are counted by wrapping malloc, calloc, realloc and free at link
+time (see the Makefile), so they include the allocations in core/bps.c.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "bps.h"
+
+#define DEFAULT_REPETITIONS     20
+#define DEFAULT_SIZE            1000
+#define MIN_REPETITION_SECONDS  0.01    // each repetition runs at least this long
+
+// ------------- allocation counting -----------
+
+long gAllocations = 0;
+long gFrees = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+    gAllocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    gAllocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    gAllocations++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr != NULL) gFrees++;
+    __real_free(ptr);
+}
+
+// ------------- benchmarks -----------
+// Each benchmark has a setup function that creates its data for a given size,
+// a function that performs one operation, and a cleanup function.
+
+typedef struct {
+    int size;
+    Solver* solver;
+    Set* set;
+    List* list;
+    NumberLayout* layout;
+    int64_t* numbers;
+} Data;
+
+// implication chain: 1 -> 2 -> ... -> n
+Solver* NewChainSolver(int n) {
+    int* rules = (int*)malloc((4*n+2)*sizeof(int));
+    int i, k = 0;
+    for (i=1;i<n;i++) {
+        rules[k++] = i; rules[k++] = 0;
+        rules[k++] = i+1; rules[k++] = 0;
+    }
+    rules[k++] = 0; rules[k++] = 0;
+    Solver* s = NewSolver(rules);
+    free(rules);
+    return s;
+}
+
+// binary fan-out tree: i -> 2i, 2i+1
+Solver* NewTreeSolver(int n) {
+    int* rules = (int*)malloc((5*n+2)*sizeof(int));
+    int i, k = 0;
+    for (i=1;2*i+1<=n;i++) {
+        rules[k++] = i; rules[k++] = 0;
+        rules[k++] = 2*i; rules[k++] = 2*i+1; rules[k++] = 0;
+    }
+    rules[k++] = 0; rules[k++] = 0;
+    Solver* s = NewSolver(rules);
+    free(rules);
+    return s;
+}
+
+// ripple carry adder chain: bits a_i, b_i, carries c_i, sums s_i, with the
+// rules of a full adder; nothing is fixed, so probing examines every variable
+Solver* NewAdderSolver(int n) {
+    int* rules = (int*)malloc((64*n+2)*sizeof(int));
+    int i, k = 0;
+    for (i=0;i<n;i++) {
+        int a = 4*i+1, b = 4*i+2, c = 4*i+3, sum = 4*i+4;
+        int cout = 4*(i+1)+3;
+        int x,y,z;
+        // for all combinations of inputs: sum and carry out
+        for (x=0;x<2;x++) for (y=0;y<2;y++) for (z=0;z<2;z++) {
+            rules[k++] = x ? a : -a;
+            rules[k++] = y ? b : -b;
+            rules[k++] = z ? c : -c;
+            rules[k++] = 0;
+            rules[k++] = ((x+y+z)%2) ? sum : -sum;
+            rules[k++] = ((x+y+z)/2) ? cout : -cout;
+            rules[k++] = 0;
+        }
+    }
+    rules[k++] = 0; rules[k++] = 0;
+    Solver* s = NewSolver(rules);
+    free(rules);
+    return s;
+}
+
+void SetupChain(Data* d) { d->solver = NewChainSolver(d->size); }
+void SetupTree(Data* d) { d->solver = NewTreeSolver(d->size); }
+void SetupAdder(Data* d) { d->solver = NewAdderSolver(d->size); }
+void CleanupSolver(Data* d) { DeleteSolver(d->solver); }
+
+// propagate and unpropagate from the root of the chain or tree
+void RunPropagate(Data* d) {
+    if (!Propagate(d->solver, 1, d->solver->gColor+1, FALSE)) exit(1);
+    Unpropagate(d->solver, 1, d->solver->gColor+1, FALSE);
+}
+
+// one probing step, then undo the fixes
+void RunProbe(Data* d) {
+    Probe(d->solver);
+    while (d->solver->gStack != NULL) PopStack(d->solver);
+}
+
+void SetupSet(Data* d) { d->set = NewSet(d->size); }
+void CleanupSet(Data* d) { DeleteSet(d->set); }
+
+// add all values, then remove them
+void RunSetAddRem(Data* d) {
+    int i;
+    for (i=0;i<d->size;i++) AddSet(d->set, i, FALSE);
+    for (i=0;i<d->size;i++) RemSet(d->set, i);
+}
+
+void SetupSetFull(Data* d) {
+    d->set = NewSet(d->size);
+    int i;
+    for (i=0;i<d->size;i+=2) AddSet(d->set, i, FALSE);
+}
+
+// look up all values (half of them are in the set)
+void RunSetGet(Data* d) {
+    int i, found = 0;
+    for (i=0;i<d->size;i++) found += (GetSetNode(d->set, i) != NULL);
+    if (found != (d->size+1)/2) exit(1);
+}
+
+void SetupNone(Data* d) { }
+void CleanupNone(Data* d) { }
+
+// build a list and delete it
+void RunListAppend(Data* d) {
+    List* list = NewList();
+    int i;
+    for (i=0;i<d->size;i++) ListAppend(list, i+1);
+    DeleteList(list);
+}
+
+void SetupList(Data* d) {
+    d->list = NewList();
+    int i;
+    for (i=0;i<d->size;i++) ListAppend(d->list, i+1);
+}
+void CleanupList(Data* d) { DeleteList(d->list); }
+
+void RunList2Array(Data* d) {
+    int* array = List2Array(d->list);
+    free(array);
+}
+
+// numbers of 9 bits (sillycon's number width), in an assignment with a fixed pattern
+void SetupNumbers(Data* d) {
+    d->solver = NewChainSolver(9*d->size);
+    int v;
+    for (v=1;v<=9*d->size;v++) {
+        d->solver->gMarkers[Literal2Index(v%3 == 0 ? v : -v)] = 1;
+    }
+    d->layout = NewNumberLayout();
+    int literals[10];
+    int i,j;
+    for (i=0;i<d->size;i++) {
+        for (j=0;j<9;j++) literals[j] = 9*i+j+1;
+        literals[9] = 0;
+        AddLayoutNumber(d->layout, literals, TRUE);
+    }
+    d->numbers = (int64_t*)malloc(d->size*sizeof(int64_t));
+}
+
+void CleanupNumbers(Data* d) {
+    DeleteSolver(d->solver);
+    DeleteNumberLayout(d->layout);
+    free(d->numbers);
+}
+
+// one number at a time
+void RunGetNumber(Data* d) {
+    int i;
+    int literals[10];
+    for (i=0;i<d->size;i++) {
+        int j;
+        for (j=0;j<9;j++) literals[j] = 9*i+j+1;
+        literals[9] = 0;
+        d->numbers[i] = GetSignedNumber(d->solver, literals);
+    }
+}
+
+// all numbers at once
+void RunGetNumbers(Data* d) {
+    GetNumbers(d->solver, d->layout, d->numbers);
+}
+
+typedef struct {
+    char* name;
+    char* description;
+    int opsPerRun;          // operations per call of run: 0 = 1, 1 = size, 2 = 2*size
+    void (*setup)(Data*);
+    void (*run)(Data*);
+    void (*cleanup)(Data*);
+} Benchmark;
+
+Benchmark gBenchmarks[] = {
+    {"propagate_chain", "propagate+unpropagate implication chain (per literal)", 1, SetupChain, RunPropagate, CleanupSolver},
+    {"propagate_tree", "propagate+unpropagate fan-out tree (per literal)", 1, SetupTree, RunPropagate, CleanupSolver},
+    {"probe_pass", "probing step of NextSolution on adder chain (per pass)", 0, SetupAdder, RunProbe, CleanupSolver},
+    {"set_add_rem", "AddSet+RemSet (per operation)", 2, SetupSet, RunSetAddRem, CleanupSet},
+    {"set_get", "GetSetNode (per lookup)", 1, SetupSetFull, RunSetGet, CleanupSet},
+    {"list_append", "ListAppend, including NewList/DeleteList (per value)", 1, SetupNone, RunListAppend, CleanupNone},
+    {"list2array", "List2Array (per list)", 0, SetupList, RunList2Array, CleanupList},
+    {"get_number", "GetSignedNumber, 9 bits (per number)", 1, SetupNumbers, RunGetNumber, CleanupNumbers},
+    {"get_numbers", "GetNumbers, 9 bits (per number)", 1, SetupNumbers, RunGetNumbers, CleanupNumbers},
+    {NULL, NULL, 0, NULL, NULL, NULL}
+};
+
+// ------------- statistics -----------
+
+// monotonic clock in seconds
+double Seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec) * 1e-9;
+}
+
+int CompareDoubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+void RunBenchmark(Benchmark* b, int size, int repetitions) {
+    Data data;
+    memset(&data, 0, sizeof(Data));
+    data.size = size;
+    b->setup(&data);
+    long ops = b->opsPerRun == 0 ? 1 : b->opsPerRun * (long)size;
+
+    // calibrate: number of runs per repetition
+    long runs = 1;
+    while (1) {
+        double start = Seconds();
+        long r;
+        for (r=0;r<runs;r++) b->run(&data);
+        if (Seconds() - start >= MIN_REPETITION_SECONDS || runs > (1L<<30)) break;
+        runs *= 2;
+    }
+
+    double* nsPerOp = (double*)malloc(repetitions*sizeof(double));
+    long allocations = 0;
+    int i;
+    for (i=0;i<repetitions;i++) {
+        long allocs = gAllocations;
+        double start = Seconds();
+        long r;
+        for (r=0;r<runs;r++) b->run(&data);
+        double seconds = Seconds() - start;
+        allocations += gAllocations - allocs;
+        nsPerOp[i] = seconds * 1e9 / (runs * ops);
+    }
+    b->cleanup(&data);
+
+    // summary
+    double mean = 0.0, variance = 0.0;
+    for (i=0;i<repetitions;i++) mean += nsPerOp[i];
+    mean /= repetitions;
+    for (i=0;i<repetitions;i++) variance += (nsPerOp[i]-mean)*(nsPerOp[i]-mean);
+    double stddev = repetitions > 1 ? sqrt(variance / (repetitions-1)) : 0.0;
+    qsort(nsPerOp, repetitions, sizeof(double), CompareDoubles);
+    printf("%-16s %10.2f %10.2f %10.2f %10.2f %12.3f  %s\n", b->name, nsPerOp[0], nsPerOp[repetitions/2],
+            mean, stddev, (double)allocations / ((double)repetitions * runs * ops), b->description);
+    free(nsPerOp);
+}
+
+int main(int argc, char** argv) {
+    int repetitions = DEFAULT_REPETITIONS;
+    int size = DEFAULT_SIZE;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:n:")) != -1) {
+        switch (opt) {
+            case 'r': repetitions = atoi(optarg); break;
+            case 'n': size = atoi(optarg); break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if (optind < argc-1 || repetitions < 1 || size < 1) {
+        fprintf(stderr, "usage: %s [-r repetitions] [-n size] [name]\n", argv[0]);
+        return 2;
+    }
+    char* name = optind < argc ? argv[optind] : NULL;
+
+    printf("size %d, %d repetitions\n", size, repetitions);
+    printf("%-16s %10s %10s %10s %10s %12s\n", "benchmark", "min ns/op", "median", "mean", "stddev", "allocs/op");
+    Benchmark* b;
+    int found = 0;
+    for (b=gBenchmarks;b->name!=NULL;b++) {
+        if (name != NULL && strcmp(name, b->name) != 0) continue;
+        RunBenchmark(b, size, repetitions);
+        found++;
+    }
+    if (found == 0) {
+        fprintf(stderr, "unknown benchmark %s\n", name);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*  Allocation profiling for the Boolean Propagation Solver and SillyCon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Only compiled in the allocation profiling build (see alloc_profile.h).
+*/
+
+#include "alloc_profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+// this file calls the real functions
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+#define MAX_PHASES      32
+#define MAX_SITES       4096        // a power of two
+#define REPORT_SITES    25          // call sites in the report
+
+// in front of every allocated block; keeps the alignment of malloc
+typedef union {
+    struct {
+        size_t size;
+        int site;
+    } info;
+    max_align_t align;
+} BlockHeader;
+
+typedef struct {
+    const char* file;
+    int line;
+    const char* func;
+    long allocations;
+    long bytes;
+} Site;
+
+typedef struct {
+    const char* name;
+    long allocations;
+    long frees;
+    long bytes;
+    long peak;          // peak live bytes during the phase
+} Phase;
+
+Site gSites[MAX_SITES];
+int gNumberOfSites = 0;
+Phase gPhases[MAX_PHASES] = {{"start", 0, 0, 0, 0}};
+int gNumberOfPhases = 1;
+int gPhase = 0;
+long gLive = 0;             // live bytes
+long gPeak = 0;             // peak live bytes
+
+// finds or adds the call site (open addressing on file and line)
+int FindSite(const char* file, int line, const char* func) {
+    unsigned int h = ((unsigned int)(size_t)file * 31u + (unsigned int)line) & (MAX_SITES-1);
+    while (gSites[h].file != NULL) {
+        if (gSites[h].line == line && gSites[h].file == file) return h;
+        h = (h+1) & (MAX_SITES-1);
+    }
+    // full: count in the last slot that was probed
+    if (gNumberOfSites >= MAX_SITES-1) return h;
+    gSites[h].file = file;
+    gSites[h].line = line;
+    gSites[h].func = func;
+    gNumberOfSites++;
+    return h;
+}
+
+void CountAllocation(BlockHeader* header, size_t size, const char* file, int line, const char* func) {
+    int site = FindSite(file, line, func);
+    header->info.size = size;
+    header->info.site = site;
+    gSites[site].allocations++;
+    gSites[site].bytes += size;
+    Phase* phase = &gPhases[gPhase];
+    phase->allocations++;
+    phase->bytes += size;
+    gLive += size;
+    if (gLive > phase->peak) phase->peak = gLive;
+    if (gLive > gPeak) gPeak = gLive;
+}
+
+void* ProfileMalloc(size_t size, const char* file, int line, const char* func) {
+    BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+    if (header == NULL) return NULL;
+    CountAllocation(header, size, file, line, func);
+    return header + 1;
+}
+
+void* ProfileCalloc(size_t count, size_t size, const char* file, int line, const char* func) {
+    BlockHeader* header = (BlockHeader*)calloc(1, sizeof(BlockHeader) + count*size);
+    if (header == NULL) return NULL;
+    CountAllocation(header, count*size, file, line, func);
+    return header + 1;
+}
+
+void ProfileFree(void* ptr) {
+    if (ptr == NULL) return;
+    BlockHeader* header = (BlockHeader*)ptr - 1;
+    gLive -= header->info.size;
+    gPhases[gPhase].frees++;
+    free(header);
+}
+
+void* ProfileRealloc(void* ptr, size_t size, const char* file, int line, const char* func) {
+    if (ptr == NULL) return ProfileMalloc(size, file, line, func);
+    BlockHeader* header = (BlockHeader*)ptr - 1;
+    size_t oldsize = header->info.size;
+    BlockHeader* newheader = (BlockHeader*)realloc(header, sizeof(BlockHeader) + size);
+    if (newheader == NULL) return NULL;
+    // counted as a free and a new allocation
+    gLive -= oldsize;
+    gPhases[gPhase].frees++;
+    CountAllocation(newheader, size, file, line, func);
+    return newheader + 1;
+}
+
+void ProfilePhase(const char* name) {
+    int i;
+    for (i=0;i<gNumberOfPhases;i++) {
+        if (strcmp(gPhases[i].name, name) == 0) break;
+    }
+    if (i == gNumberOfPhases) {
+        if (gNumberOfPhases == MAX_PHASES) return;
+        memset(&gPhases[i], 0, sizeof(Phase));
+        gPhases[i].name = name;
+        gNumberOfPhases++;
+    }
+    gPhase = i;
+    if (gLive > gPhases[i].peak) gPhases[i].peak = gLive;
+}
+
+int CompareSites(const void* a, const void* b) {
+    const Site* sa = *(const Site**)a;
+    const Site* sb = *(const Site**)b;
+    return (sb->allocations > sa->allocations) - (sb->allocations < sa->allocations);
+}
+
+void ProfileReport(FILE* file) {
+    long allocations = 0;
+    long bytes = 0;
+    int i;
+    fprintf(file, "\nAllocations per phase:\n");
+    fprintf(file, "%-12s %12s %12s %14s %14s\n", "phase", "allocations", "frees", "bytes", "peak live");
+    for (i=0;i<gNumberOfPhases;i++) {
+        Phase* phase = &gPhases[i];
+        if (phase->allocations == 0 && phase->frees == 0) continue;
+        fprintf(file, "%-12s %12ld %12ld %14ld %14ld\n", phase->name, phase->allocations, phase->frees,
+                phase->bytes, phase->peak);
+        allocations += phase->allocations;
+        bytes += phase->bytes;
+    }
+    fprintf(file, "%-12s %12ld %12s %14ld %14ld\n", "total", allocations, "", bytes, gPeak);
+
+    // call sites with the most allocations
+    Site* sites[MAX_SITES];
+    int n = 0;
+    for (i=0;i<MAX_SITES;i++) {
+        if (gSites[i].file != NULL) sites[n++] = &gSites[i];
+    }
+    qsort(sites, n, sizeof(Site*), CompareSites);
+    fprintf(file, "\nAllocations per call site (%d sites):\n", n);
+    fprintf(file, "%12s %7s %14s  %s\n", "allocations", "%", "bytes", "site");
+    for (i=0;i<n && i<REPORT_SITES;i++) {
+        fprintf(file, "%12ld %6.1f%% %14ld  %s:%d %s\n", sites[i]->allocations,
+                allocations > 0 ? 100.0 * sites[i]->allocations / allocations : 0.0,
+                sites[i]->bytes, sites[i]->file, sites[i]->line, sites[i]->func);
+    }
+}
@@ -21,6 +21,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
 
 // logging
 #ifdef LOG_PROPAGATIONS
@@ -56,6 +63,61 @@ Node* NewNode (int value) {
     return l;
 }
 
+// ------ pool of nodes ----
+
+#define MIN_SLAB    4       // nodes in the first slab of a pool
+#define MAX_SLAB    1024    // slabs double in size up to this
+
+typedef struct {
+    void* prev;         // (NodeSlab*)
+    int size;           // number of nodes
+    Node nodes[];
+} NodeSlab;
+
+void InitPool (NodePool* pool) {
+    pool->free = NULL;
+    pool->slab = NULL;
+    pool->used = 0;
+}
+
+Node* PoolNode (NodePool* pool, int value) {
+    Node* node = pool->free;
+    if (node != NULL) {
+        pool->free = node->next;
+    } else {
+        NodeSlab* slab = (NodeSlab*)pool->slab;
+        if (slab == NULL || pool->used == slab->size) {
+            int size = slab == NULL ? MIN_SLAB : (slab->size < MAX_SLAB ? 2*slab->size : MAX_SLAB);
+            NodeSlab* newslab = (NodeSlab*)malloc(sizeof(NodeSlab) + size*sizeof(Node));
+            newslab->prev = slab;
+            newslab->size = size;
+            pool->slab = newslab;
+            pool->used = 0;
+            slab = newslab;
+        }
+        node = &slab->nodes[pool->used++];
+    }
+    node->value = value;
+    node->next = NULL;
+    node->prev = NULL;
+    return node;
+}
+
+void PoolFree (NodePool* pool, Node* node) {
+    node->next = pool->free;
+    pool->free = node;
+}
+
+void ReleasePool (NodePool* pool) {
+    NodeSlab* slab = (NodeSlab*)pool->slab;
+    while (slab != NULL) {
+        NodeSlab* prev = (NodeSlab*)slab->prev;
+        free(slab);
+        slab = prev;
+    }
+    InitPool(pool);
+}
+
 Set* NewSet (int capacity) 
 {
     Set* newset = (Set*)malloc(sizeof(Set));
@@ -63,6 +125,7 @@ Set* NewSet (int capacity)
     newset->count = 0;
     newset->first = NULL;
     newset->last = NULL;
+    InitPool(&newset->pool);
     newset->value2node = (Node**)malloc(newset->capacity*sizeof(Node*));
     int value;
     for (value=0;value<newset->capacity;value++) {
@@ -74,11 +137,7 @@ Set* NewSet (int capacity)
 void DeleteSet (Set* set) 
 {
     if (set != NULL) {
-        int value;
-        for (value=0;value<set->capacity;value++) {
-            Node* node = set->value2node[value];
-            if (node != NULL) free(node);
-        }
+        ReleasePool(&set->pool);
         if (set->value2node != NULL) free(set->value2node);
         free(set);
     }
@@ -105,7 +164,7 @@ Node* AddSet (Set* set, int value, int front)
         if (node == NULL) {
             if (value >= 0 && value < set->capacity) {
                 // create new node
-                node = NewNode(value);
+                node = PoolNode(&set->pool, value);
                 // store in map
                 set->value2node[value] = node;
                 if (front) {
@@ -148,7 +207,7 @@ Node* RemSet(Set* set, int value) {
             if (node->next != NULL) ((Node*)node->next)->prev = node->prev;    
             if (node == set->first) set->first = node->next;
             if (node == set->last) set->last = node->prev;
-            free(node);
+            PoolFree(&set->pool, node);
             set->count--;
             //DEBUGPRINTF("count=%d\n", set->count);
         }    
@@ -156,6 +215,12 @@ Node* RemSet(Set* set, int value) {
    return NULL; 
 }
 
+// approximate number of bytes allocated for a set
+long SetMemory(Set* set) {
+    if (set == NULL) return 0;
+    return sizeof(Set) + set->capacity*sizeof(Node*) + set->count*sizeof(Node);
+}
+
 // ------ list of integers ----
 // A list of integers.
 // Implemented as a double ended queue.
@@ -165,24 +230,18 @@ Node* RemSet(Set* set, int value) {
 
 List* NewList () 
 {
-    List* newlist = (List*)malloc(sizeof(Set));
+    List* newlist = (List*)malloc(sizeof(List));
     newlist->count = 0;
     newlist->first = NULL;
     newlist->last = NULL;
+    InitPool(&newlist->pool);
     return newlist;
 }
 
 void DeleteList (List* list) 
 {
     if (list != NULL) {
-            
-        Node* node = list->first;
-        Node* next;
-        while(node) {
-            next = node->next;    
-            if (node != NULL) free(node);   
-            node = next;
-        }
+        ReleasePool(&list->pool);
         free(list);
     }
 }
@@ -191,7 +250,7 @@ Node* ListPrepend (List* list, int value)
 {
     if (list != NULL) {
         // create new node
-        Node* node = NewNode(value);
+        Node* node = PoolNode(&list->pool, value);
         // prepend to list
         //DEBUGPRINTF("prepend %d\n", value);
         if (list->first != NULL)
@@ -211,7 +270,7 @@ Node* ListAppend (List* list, int value)
 {
     if (list != NULL) {
         // create new node
-        Node* node = NewNode(value);
+        Node* node = PoolNode(&list->pool, value);
         // append to list
         //DEBUGPRINTF("append %d\n", value);
         if (list->last != NULL) {
@@ -235,7 +294,7 @@ int ListPopEnd (List* list)
         Node* prev = (Node*)list->last->prev;
         if (prev != NULL) prev->next = NULL;
         if (list->last == list->first) list->first = NULL;
-        free(list->last);
+        PoolFree(&list->pool, list->last);
         list->last = prev;
         list->count--;
         return value;
@@ -250,7 +309,7 @@ int ListPopFront (List* list)
         Node* next = (Node*)list->first->next;
         if (next != NULL) next->prev = NULL;
         if (list->first == list->last) list->last = NULL;
-        free(list->first);
+        PoolFree(&list->pool, list->first);
         list->first = next;
         list->count--;
         return value;
@@ -258,6 +317,67 @@ int ListPopFront (List* list)
     return 0;
 }
 
+int* List2Array(List* l) {
+    if (l==NULL) return NULL;
+    if (l->count < 1) return NULL;
+    int* a = malloc((l->count+2)*sizeof(int));
+    int i = 0;
+    Node* n = l->first;
+    while (n) {
+        a[i++] = n->value;
+        n = n->next;
+    }
+    a[i++] = 0;
+    a[i++] = 0;
+    return a;
+}
+
+// ------ buffer of integers ----
+// A growable array of integers (see bps_types.h).
+
+Buffer* NewBuffer (int capacity)
+{
+    Buffer* buffer = (Buffer*)malloc(sizeof(Buffer));
+    buffer->count = 0;
+    buffer->capacity = capacity > 0 ? capacity : 16;
+    // room for the terminating zeros of BufferArray
+    buffer->values = (int*)malloc((buffer->capacity+2)*sizeof(int));
+    return buffer;
+}
+
+void DeleteBuffer (Buffer* buffer)
+{
+    if (buffer != NULL) {
+        free(buffer->values);
+        free(buffer);
+    }
+}
+
+void BufferAppend (Buffer* buffer, int value)
+{
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity *= 2;
+        buffer->values = (int*)realloc(buffer->values, (buffer->capacity+2)*sizeof(int));
+    }
+    buffer->values[buffer->count++] = value;
+}
+
+Buffer* CopyBuffer (Buffer* buffer)
+{
+    Buffer* copy = NewBuffer(buffer->count);
+    memcpy(copy->values, buffer->values, buffer->count*sizeof(int));
+    copy->count = buffer->count;
+    return copy;
+}
+
+// the values followed by two zeros, valid until the next append
+int* BufferArray (Buffer* buffer)
+{
+    buffer->values[buffer->count] = 0;
+    buffer->values[buffer->count+1] = 0;
+    return buffer->values;
+}
+
 // ------------------------ algorithmics -------------
 // Adds a variable (input may also be a negative literal)
 // updates s->gNumberOfVariables to the max abs value
@@ -297,6 +417,110 @@ int OppositeIndex(int index) {
         return index-1;
 }
 
+// ------------- ranked variables -----------
+
+// swap two entries of the heap
+void HeapSwap(Solver* s, int i, int j) {
+    int vi = s->gHeap[i];
+    int vj = s->gHeap[j];
+    s->gHeap[i] = vj;
+    s->gHeap[j] = vi;
+    s->gHeapPos[vj] = i;
+    s->gHeapPos[vi] = j;
+}
+
+// restore heap order from position i towards the top
+void HeapUp(Solver* s, int i) {
+    while (i > 0) {
+        int parent = (i-1)/2;
+        if (s->gRank[s->gHeap[parent]] <= s->gRank[s->gHeap[i]]) break;
+        HeapSwap(s, i, parent);
+        i = parent;
+    }
+}
+
+// restore heap order from position i towards the bottom
+void HeapDown(Solver* s, int i) {
+    while (1) {
+        int child = 2*i+1;
+        if (child >= s->gHeapSize) break;
+        if (child+1 < s->gHeapSize && s->gRank[s->gHeap[child+1]] < s->gRank[s->gHeap[child]]) child++;
+        if (s->gRank[s->gHeap[i]] <= s->gRank[s->gHeap[child]]) break;
+        HeapSwap(s, i, child);
+        i = child;
+    }
+}
+
+// add a (ranked) variable to the heap
+void HeapInsert(Solver* s, int var) {
+    if (s->gHeapPos[var] >= 0) return;
+    s->gHeap[s->gHeapSize] = var;
+    s->gHeapPos[var] = s->gHeapSize;
+    s->gHeapSize++;
+    HeapUp(s, s->gHeapSize-1);
+}
+
+// remove a variable from the heap 
+void HeapRemove(Solver* s, int var) {
+    int i = s->gHeapPos[var];
+    if (i < 0) return;
+    s->gHeapSize--;
+    if (i != s->gHeapSize) {
+        // move the last entry to the free position
+        int last = s->gHeap[s->gHeapSize];
+        s->gHeap[i] = last;
+        s->gHeapPos[last] = i;
+        HeapUp(s, i);
+        HeapDown(s, s->gHeapPos[last]);
+    }
+    s->gHeapPos[var] = -1;
+}
+
+// ranks the ordered variables and projected variables, and fills the heap with free ranked variables
+void RankVariables(Solver* s) {
+    int n = s->gNumberOfVariables;
+    int var;
+    for (var=0;var<=n;var++) {
+        s->gRank[var] = -1;
+        s->gHeapPos[var] = -1;
+    }
+    s->gHeapSize = 0;
+    int rank = 0;
+    // with a projection, ordered variables that are not projected come last
+    int pass;
+    for (pass=0;pass<3;pass++) {
+        if (pass == 1 && s->gProjection != NULL) {
+            int* pv;
+            for (pv=s->gProjection;*pv!=0;pv++)
+                if (s->gRank[*pv] < 0) s->gRank[*pv] = rank++;
+            continue;
+        }
+        if (pass == 1) continue;
+        Node* ordervar;
+        for (ordervar=s->ordered->first;ordervar;ordervar=ordervar->next) {
+            var = abs(ordervar->value);
+            if (var < 1 || var > n || s->gRank[var] >= 0) continue;
+            int projected = (s->gProjected == NULL || s->gProjected[var]);
+            if ((pass == 0) == projected) s->gRank[var] = rank++;
+        }
+    }
+    for (var=1;var<=n;var++) {
+        if (s->gRank[var] >= 0 && GetSetNode(s->gFreeVars, var) != NULL) HeapInsert(s, var);
+    }
+}
+
+// statistics of firing rule c, before its rhs literals are propagated
+void CountRuleFiring(Solver* s, int c) {
+    RuleStatistics* stats = &s->gRuleStatistics[c];
+    stats->firings++;
+    int ki;
+    for (ki=0;ki<s->gC2N[c];ki++) {
+        int k = s->gC2L[c][ki];
+        if (s->gMarkers[Literal2Index(-k)] != 0) stats->conflicts++;
+        else if (s->gMarkers[Literal2Index(k)] == 0) stats->propagations++;
+    }
+}
+
 /* assign color to given literal and propagate to other literals by following rules 
    the color is only assigned to free literals (value 0).
    If updateFreeVars is TRUE then the global free variables are updated.
@@ -321,7 +545,10 @@ int Propagate(Solver* s, int lv, int color, int updateFreeVars) {
     //DEBUGPRINTF("propagated literal %d=%d\n",lv,s->gMarkers[li]);
     // remove from free literals
     int var = abs(lv);
-    if (updateFreeVars) RemSet(s->gFreeVars, var);
+    if (updateFreeVars) {
+        RemSet(s->gFreeVars, var);
+        if (s->gRank[var] >= 0) HeapRemove(s, var);
+    }
     //DEBUGPRINTF("s->gFreeVars removed %d\n", var);
     //DEBUGPRINTF("s->gFreeVars.count=%d\n",s->gFreeVars->count);
     // first decrement all counters 
@@ -337,6 +564,7 @@ int Propagate(Solver* s, int lv, int color, int updateFreeVars) {
         c = s->gL2C[li][ci];
         if (s->gCounters[c]==0) {
             //DEBUGPRINTF("fire rule %d\n",c);
+            if (s->gRuleStatistics != NULL) CountRuleFiring(s, c);
             for (ki=0;ki<s->gC2N[c];ki++) {
                 k = s->gC2L[c][ki];
                 // recurse and escape if failed
@@ -360,6 +588,7 @@ void Unpropagate(Solver* s, int lv, int color, int updateFreeVars) {
     // add to free variables if both literals of same var are marked 0
     if (updateFreeVars && s->gMarkers[Literal2Index(-lv)] == 0) {
         AddSet(s->gFreeVars, abs(lv), FALSE);
+        if (s->gRank[abs(lv)] >= 0) HeapInsert(s, abs(lv));
         //DEBUGPRINTF("s->gFreeVars added %d\n", abs(lv));
         //DEBUGPRINTF("s->gFreeVars.count=%d\n",s->gFreeVars->count);
     }
@@ -422,6 +651,12 @@ void init(Solver* s, int *problem) {
     // next iterations don't need to parse further than this
     int stoppos = parsepos;
 
+    // checksum of the problem (FNV-1a), to check saved states 
+    s->gChecksum = 2166136261u;
+    for (parsepos=0;parsepos<stoppos;parsepos++) {
+        s->gChecksum = (s->gChecksum ^ (unsigned int)problem[parsepos]) * 16777619u;
+    }
+
     DEBUGPRINTF("gNumberOfRules=%d\n",s->gNumberOfRules);
     LOG("vars %d\n",s->gNumberOfVariables);     
     LOG("rules %d\n",s->gNumberOfRules);     
@@ -595,6 +830,7 @@ void init(Solver* s, int *problem) {
     
     // clear progagation color and stack
     s->gStack = NULL;
+    InitPool(&s->gStackPool);
     s->gColor = 1;
 
     // clear statistics
@@ -603,47 +839,368 @@ void init(Solver* s, int *problem) {
  
     // no ordered variables
     s->ordered = NewList();
+    s->gRank = (int*)malloc((s->gNumberOfVariables+1)*sizeof(int));
+    s->gHeap = (int*)malloc((s->gNumberOfVariables+1)*sizeof(int));
+    s->gHeapPos = (int*)malloc((s->gNumberOfVariables+1)*sizeof(int));
+
+    // no limits
+    memset(&s->gSolverLimits, 0, sizeof(Limits));
+    memset(&s->gCallLimits, 0, sizeof(Limits));
+    s->gSeconds = 0.0;
+    atomic_init(&s->gInterrupt, 0);
+    s->gResume = -1;
+    s->gResumeVar = 0;
+    s->gResumeCount = -1;
+    s->gLastResult = SEARCH_EXHAUSTED;
+    s->gProjection = NULL;
+    s->gProjected = NULL;
+    s->gSkipAlternatives = 0;
+    s->gDepth = 0;
+    s->gFloor = 0;
+    s->gRuleStatistics = NULL;
+    s->gPerf = NULL;
+    RankVariables(s);
+
+    // approximate memory usage of above datastructures
+    s->gMemory = sizeof(Solver);
+    s->gMemory += numlits * (sizeof(int) + sizeof(int*) + sizeof(int));
+    s->gMemory += s->gNumberOfRules * (sizeof(int) + sizeof(int*) + sizeof(int));
+    s->gMemory += (stoppos - 2*s->gNumberOfRules) * sizeof(int);
+    s->gMemory += SetMemory(s->gFreeVars);
+    s->gMemory += 3 * (s->gNumberOfVariables+1) * sizeof(int);
 
 } // init
 
+// ------------- decision stack -----------
+
+// push a choice or a fix (literal + FIXOFFSET) on the stack
+void PushStack(Solver* s, int value) {
+    Node* newstack = PoolNode(&s->gStackPool, value);
+    newstack->next = s->gStack;  
+    s->gStack = newstack;
+    s->gMemory += sizeof(Node);
+    s->gDepth++;
+}
+
+// the literal of a choice or fix on the stack
+int StackLiteral(Solver* s, int value) {
+    if (value > s->gNumberOfVariables)
+        return value - FIXOFFSET(s);
+    else
+        return value;
+}
+
+// undo the last choice or fix and pop it from the stack
+void PopStack(Solver* s) {
+    Unpropagate(s, StackLiteral(s, s->gStack->value), s->gColor, TRUE);
+    s->gColor-=1;
+    Node* todelete = s->gStack;
+    s->gStack = s->gStack->next; 
+    PoolFree(&s->gStackPool, todelete);
+    s->gMemory -= sizeof(Node);
+    s->gDepth--;
+}
+
+// ------------- resource limits -----------
+
+// statistics at the start of a call of NextSolution (or Optimize)
+typedef struct {
+    int numprop;
+    int numchoice;
+    double time;
+    double seconds;     // Solver.gSeconds at the start
+} CallStart;
+
+// monotonic wall clock time in seconds
+double WallTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec) * 1e-9;
+}
+
+// returns non-zero if the solver was interrupted, or if any limit is reached
+int LimitReached(Solver* s, CallStart* start) {
+    // clear the interrupt request, so the search can be resumed
+    if (atomic_load_explicit(&s->gInterrupt, memory_order_relaxed)) {
+        atomic_store(&s->gInterrupt, 0);
+        return 1;
+    }
+    Limits* sl = &s->gSolverLimits;
+    Limits* cl = &s->gCallLimits;
+    if (sl->propagations > 0 && s->gNumProp >= sl->propagations) return 1;
+    if (cl->propagations > 0 && s->gNumProp - start->numprop >= cl->propagations) return 1;
+    if (sl->choices > 0 && s->gNumChoice >= sl->choices) return 1;
+    if (cl->choices > 0 && s->gNumChoice - start->numchoice >= cl->choices) return 1;
+    if (sl->memory > 0 && s->gMemory > sl->memory) return 1;
+    if (cl->memory > 0 && s->gMemory > cl->memory) return 1;
+    // only look at the clock if there is a time limit
+    if (sl->seconds > 0 || cl->seconds > 0) {
+        double elapsed = WallTime() - start->time;
+        if (sl->seconds > 0 && start->seconds + elapsed >= sl->seconds) return 1;
+        if (cl->seconds > 0 && elapsed >= cl->seconds) return 1;
+    }
+    return 0;
+}
+
+// ------------- performance counters -----------
+
+// ends the current phase and starts the given phase, if counting
+#define PERF_PHASE(s, phase) if ((s)->gPerf != NULL) PerfPhase(s, phase);
+
+const char* gPerfCounterNames[NUM_PERF_COUNTERS] = {"cycles", "instructions", "cache-misses", "branch-misses", "page-faults"};
+const char* gPerfPhaseNames[NUM_PERF_PHASES] = {"probe", "decide", "backtrack", "extract"};
+
+// adds the counts since the start of the current phase to that phase
+void PerfPhase(Solver* s, int phase) {
+    PerfCounters* perf = s->gPerf;
+    int i;
+    for (i=0;i<NUM_PERF_COUNTERS;i++) {
+        long long value;
+        if (perf->fds[i] < 0 || read(perf->fds[i], &value, sizeof(value)) != sizeof(value)) continue;
+        if (perf->phase != PERF_NONE) perf->values[perf->phase][i] += value - perf->start[i];
+        perf->start[i] = value;
+    }
+    perf->phase = phase;
+}
+
+void DisablePerfCounters(Solver* s) {
+    int i;
+    for (i=0;i<NUM_PERF_COUNTERS;i++) {
+        if (s->gPerf->fds[i] >= 0) close(s->gPerf->fds[i]);
+    }
+    free(s->gPerf);
+    s->gPerf = NULL;
+    s->gMemory -= sizeof(PerfCounters);
+}
+
+int EnablePerfCounters(Solver* s) {
+    if (s->gPerf != NULL) DisablePerfCounters(s);
+    PerfCounters* perf = (PerfCounters*)calloc(1, sizeof(PerfCounters));
+    perf->phase = PERF_NONE;
+    int available = 0;
+    int i;
+    for (i=0;i<NUM_PERF_COUNTERS;i++) {
+        perf->fds[i] = -1;
+#ifdef __linux__
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (i) {
+            case 0: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case 1: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case 2: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+            case 3: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            case 4: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS; break;
+        }
+        // this thread only, user space only (allowed for unprivileged users)
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        perf->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf->fds[i] >= 0) available++;
+#endif
+    }
+    if (available == 0) {
+        free(perf);
+        return 0;
+    }
+    s->gPerf = perf;
+    s->gMemory += sizeof(PerfCounters);
+    return available;
+}
+
+void WritePerfCounters(Solver* s, FILE* file) {
+    if (s->gPerf == NULL) return;
+    int i,p;
+    for (i=0;i<NUM_PERF_COUNTERS;i++) {
+        if (s->gPerf->fds[i] < 0) continue;
+        long long total = 0;
+        for (p=0;p<NUM_PERF_PHASES;p++) total += s->gPerf->values[p][i];
+        fprintf(file, "%lld %s (", total, gPerfCounterNames[i]);
+        for (p=0;p<NUM_PERF_PHASES;p++) {
+            fprintf(file, "%s%s %lld", p > 0 ? ", " : "", gPerfPhaseNames[p], s->gPerf->values[p][i]);
+        }
+        fprintf(file, ")\n");
+    }
+}
+
+// ------------- probing ----------- 
+
+/* propagate all literals for which the antagonist cannot be propagated, and push
+   them on the stack as fixes, until no more variables can be fixed.
+   Returns 0 if a variable is found with no possible literal propagations, 1 if not,
+   or LIMIT_REACHED if a limit was reached (only if start is not NULL); the variable 
+   to continue with is then kept in s->gResumeVar. 
+*/
+int ProbeFreeVariables(Solver* s, CallStart* start) {
+    int lastcount = -1;
+    int i = 0;
+    int limit = 0;
+    int conflict = 0;
+    int resuming = (s->gResumeVar != 0);
+    while (resuming || s->gFreeVars->count != lastcount) { 
+        // a pass that was stopped by a limit continues at the variable where it stopped
+        Node* startvar = NULL;
+        if (resuming) {
+            lastcount = s->gResumeCount;
+            startvar = GetSetNode(s->gFreeVars, s->gResumeVar);
+            s->gResumeVar = 0;
+            resuming = 0;
+        }
+        if (startvar == NULL) {
+            lastcount = s->gFreeVars->count;
+            startvar = s->gFreeVars->first;
+        }
+        i++;
+        DEBUGPRINTF("Iter %d, color=%d freevars=%d\n", i, s->gColor,s->gFreeVars->count);
+    
+        // unfortunately need to copy because order of s->gFreeVars can change during (Un)Propagate so we cannot iterate over it
+        // NOTE: A simply linked list stack or queue would be suffient too!
+        // Or maybe we can change the order in which variables are pushed onto s->gFreeVars?
+
+        Set* freevarscopy = NewSet(s->gNumberOfVariables+1);
+        Node* freevar = startvar;
+        while (freevar) {
+            AddSet(freevarscopy, freevar->value, FALSE);
+            freevar = freevar -> next;
+        }
+        s->gMemory += SetMemory(freevarscopy);
+
+        // for all freevars in copy (note: freevars may be left at end of while)
+        freevar = freevarscopy->first;
+        while (freevar) {
+            int var = freevar->value;
+            // check that var is still free
+            if (GetSetNode(s->gFreeVars, var) == NULL) { 
+                DEBUGPRINTF("Skip literal %d color=%d freevars=%d\n",+var, s->gColor, s->gFreeVars->count);
+                ASSERT(s->gMarkers[Literal2Index(var)]!=0 || s->gMarkers[Literal2Index(-var)]!=0);
+                freevar = freevar->next;
+                continue;
+            }
+            ASSERT(s->gMarkers[Literal2Index(var)]==0 && s->gMarkers[Literal2Index(-var)]==0);
+            int count1 = s->gFreeVars->count;
+            int total1 = s->gTotalCount;
+           
+            // try TRUE
+            int pos = Propagate(s, +var, -1, FALSE);   // color -1, does not conflict with Fixes and Choices! 
+            Unpropagate(s, +var, -1, FALSE);
+            // try FALSE
+            int neg = Propagate(s, -var, -1, FALSE);   // color -1, does not conflict with Fixes and Choices! 
+            Unpropagate(s, -var, -1, FALSE);
+            
+            int count2 = s->gFreeVars->count;
+            int total2 = s->gTotalCount;
+            ASSERT(count1==count2);
+            ASSERT(total1==total2);
+
+            // which combination?
+            if (pos && !neg) { 
+                s->gColor+=1;
+                ASSERT(Propagate(s, +var, s->gColor, TRUE));
+                DEBUGPRINTF("Fix literal %d color=%d freevars=%d\n",+var, s->gColor, s->gFreeVars->count);
+                // push special value on stack
+                PushStack(s, +var + FIXOFFSET(s));
+            }
+            else if (neg && !pos) {
+                s->gColor+=1;
+                ASSERT(Propagate(s, -var, s->gColor, TRUE));
+                DEBUGPRINTF("Fix literal %d color=%d freevars=%d\n",-var, s->gColor, s->gFreeVars->count);
+                // push special value on stack
+                PushStack(s, -var + FIXOFFSET(s));
+            }
+            else if (!neg && !pos) 
+            {    
+                DEBUGPRINTF("No options for variable %d\n",var);
+                // conflict! 
+                conflict = 1;
+                break;
+            }
+            else {
+                DEBUGPRINTF("Keep free variable %d\n",var);
+            }
+            freevar = freevar->next;
+            // stop probing if a limit is reached; fixes so far are kept on the stack
+            // (checked after probing, so every call makes progress)
+            while (freevar != NULL && GetSetNode(s->gFreeVars, freevar->value) == NULL)
+                freevar = freevar->next;
+            if (freevar != NULL && start != NULL && LimitReached(s, start)) {
+                s->gResumeVar = freevar->value;
+                s->gResumeCount = lastcount;
+                limit = 1;
+                break;
+            }
+        }   // for
+    
+        s->gMemory -= SetMemory(freevarscopy);
+        DeleteSet(freevarscopy);
+    
+        if (limit == 1) return LIMIT_REACHED;
+        if (conflict == 1) return 0;       // a variable has no options
+    }       // while freevars->count != lastcount
+    return 1;
+}
+
+int Probe(Solver* s) {
+    PERF_PHASE(s, PERF_PROBE)
+    int result = ProbeFreeVariables(s, NULL);
+    PERF_PHASE(s, PERF_NONE)
+    return result;
+}
+
 // ------------- API ----------- 
 
-// continue solving until solution found or no (more) solutions exist 
-// returns non-zero if a solution was found
-int NextSolution(Solver* s) {
+// continue solving until solution found, no (more) solutions exist or a limit is reached
+// returns SOLUTION_FOUND, SEARCH_EXHAUSTED or LIMIT_REACHED
+int Search(Solver* s, CallStart* start) {
     
     LOG("next\n")
 
     DEBUGPRINTF("NextSolution; color = %d\n",s->gColor);
   
     int backtrack = 0;
-    if (s->gFreeVars->count == 0) backtrack = 1; 
+    if (s->gResume != -1) {
+        // continue where the previous call stopped
+        backtrack = s->gResume;
+        s->gResume = -1;
+    }
+    else if (s->gFreeVars->count == 0) backtrack = 1; 
     
     while (1) {
 
+        // stop if a limit is reached; the state is kept so the search can resume
+        if (LimitReached(s, start)) {
+            LOG("limit\n")
+            s->gResume = backtrack;
+            return LIMIT_REACHED;
+        }
+
         // backtrack - undo last choice and try alternative if there is one 
         if (backtrack == 1) {
+            PERF_PHASE(s, PERF_BACKTRACK)
             DEBUGPRINTF("Backtrack, color=%d, freevars=%d\n", s->gColor,s->gFreeVars->count);
             LOG("backtrack\n")
-            //  check stack
-            if (s->gStack != NULL) { 
+            //  check stack (assumptions below the floor are never undone)
+            if (s->gDepth > s->gFloor) { 
 
                 // if the last entry is negative literal, try positive
                 if  (s->gStack->value > s->gNumberOfVariables) {
-                    // special value indicates a fixed literal on the stack
+                    // special value indicates a fixed literal on the stack (see FIXOFFSET)
                     // undo fix 
-                    int lit = s->gStack->value - 2*s->gNumberOfVariables;
-                    Unpropagate(s, lit, s->gColor, TRUE);
-                    s->gColor-=1;
-                    DEBUGPRINTF("Unfix: %d color=%d, freevars=%d\n", lit, s->gColor,s->gFreeVars->count);
-                    // pop stack 
-                    Node* todelete = s->gStack;
-                    s->gStack = s->gStack->next; 
-                    free(todelete); 
+                    DEBUGPRINTF("Unfix: %d color=%d, freevars=%d\n", StackLiteral(s, s->gStack->value), s->gColor-1,s->gFreeVars->count);
+                    PopStack(s);
                     // continue backtracking 
                     backtrack = 1;
                 }
+                else if  (s->gStack->value < 0 && s->gSkipAlternatives && !s->gProjected[-s->gStack->value]) {
+                    // after a projected solution, the other completions of the projected 
+                    // variables are not needed; undo choice without trying alternative
+                    DEBUGPRINTF("Skip alternative: %d color=%d, freevars=%d\n", s->gStack->value, s->gColor-1,s->gFreeVars->count);
+                    PopStack(s);
+                    backtrack = 1;
+                }
                 else if  (s->gStack->value < 0) {
+                    // an alternative of a projected choice gives a new projected assignment
+                    s->gSkipAlternatives = 0;
                     // statistics
                     s->gNumChoice++;
                     // undo previous choice
@@ -673,15 +1230,9 @@ int NextSolution(Solver* s) {
                 }
                 else 
                 {
-                    // undo previous choice (alternative)
-                    Unpropagate(s, s->gStack->value, s->gColor, TRUE);
-                    s->gColor-=1;
-                    DEBUGPRINTF("Unalternative: %d color=%d, freevars=%d\n", s->gStack->value, s->gColor,s->gFreeVars->count);
-                    
-                    // pop stack 
-                    Node* todelete = s->gStack;
-                    s->gStack = s->gStack->next; 
-                    free(todelete); 
+                    // undo previous choice (alternative) and pop stack
+                    DEBUGPRINTF("Unalternative: %d color=%d, freevars=%d\n", s->gStack->value, s->gColor-1,s->gFreeVars->count);
+                    PopStack(s);
          
                     // continue backtracking
                     backtrack = 1;
@@ -689,7 +1240,8 @@ int NextSolution(Solver* s) {
             }
             else
             {
-                // empty stack, search exhausted!
+                // empty stack (down to the assumptions), search exhausted!
+                s->gSkipAlternatives = 0;
                 return 0;
             }
         } // endif backtrack   
@@ -697,92 +1249,18 @@ int NextSolution(Solver* s) {
         {   // forward pass - try to fix variables and make choice if you have to 
             DEBUGPRINTF("Forwards, color=%d freevars=%d\n", s->gColor,s->gFreeVars->count);
 
-            // propagate all literals for which the antagonist cannot be propagated
-            // and backtrack if variables are found with no possible literal propagations
-            int lastcount = -1;
-            int i = 0;
-            while (s->gFreeVars->count != lastcount) { 
-                lastcount = s->gFreeVars->count;
-                i++;
-                DEBUGPRINTF("Iter %d, color=%d freevars=%d\n", i, s->gColor,s->gFreeVars->count);
-            
-                // unfortunately need to copy because order of s->gFreeVars can change during (Un)Propagate so we cannot iterate over it
-                // NOTE: A simply linked list stack or queue would be suffient too!
-                // Or maybe we can change the order in which variables are pushed onto s->gFreeVars?
-
-                Set* freevarscopy = NewSet(s->gNumberOfVariables+1);
-                Node* freevar = s->gFreeVars->first;
-                while (freevar) {
-                    AddSet(freevarscopy, freevar->value, FALSE);
-                    freevar = freevar -> next;
-                }
-
-                // for all freevars in copy (note: freevars may be left at end of while)
-                freevar = freevarscopy->first;
-                while (freevar) {
-                    int var = freevar->value;
-                    // check that var is still free
-                    if (GetSetNode(s->gFreeVars, var) == NULL) { 
-                        DEBUGPRINTF("Skip literal %d color=%d freevars=%d\n",+var, s->gColor, s->gFreeVars->count);
-                        ASSERT(s->gMarkers[Literal2Index(var)]!=0 || s->gMarkers[Literal2Index(-var)]!=0);
-                        freevar = freevar->next;
-                        continue;
-                    }
-                    ASSERT(s->gMarkers[Literal2Index(var)]==0 && s->gMarkers[Literal2Index(-var)]==0);
-                    int count1 = s->gFreeVars->count;
-                    int total1 = s->gTotalCount;
-                   
-                    // try TRUE
-                    int pos = Propagate(s, +var, -1, FALSE);   // color -1, does not conflict with Fixes and Choices! 
-                    Unpropagate(s, +var, -1, FALSE);
-                    // try FALSE
-                    int neg = Propagate(s, -var, -1, FALSE);   // color -1, does not conflict with Fixes and Choices! 
-                    Unpropagate(s, -var, -1, FALSE);
-                    
-                    int count2 = s->gFreeVars->count;
-                    int total2 = s->gTotalCount;
-                    ASSERT(count1==count2);
-                    ASSERT(total1==total2);
-
-                    // which combination?
-                    if (pos && !neg) { 
-                        s->gColor+=1;
-                        ASSERT(Propagate(s, +var, s->gColor, TRUE));
-                        DEBUGPRINTF("Fix literal %d color=%d freevars=%d\n",+var, s->gColor, s->gFreeVars->count);
-                        // push special value on stack
-                        Node* newstack = NewNode(var + 2*s->gNumberOfVariables);
-                        newstack->next = s->gStack;  
-                        s->gStack = newstack;
-                    }
-                    else if (neg && !pos) {
-                        s->gColor+=1;
-                        ASSERT(Propagate(s, -var, s->gColor, TRUE));
-                        DEBUGPRINTF("Fix literal %d color=%d freevars=%d\n",-var, s->gColor, s->gFreeVars->count);
-                        // push special value on stack
-                        Node* newstack = NewNode(-var + 2*s->gNumberOfVariables);
-                        newstack->next = s->gStack;  
-                        s->gStack = newstack;
-                    }
-                    else if (!neg && !pos) 
-                    {    
-                        DEBUGPRINTF("No options for variable %d\n",var);
-                        // conflict! Backtrack
-                        // return Backtrack();
-                        backtrack = 1;
-                        break;
-                    }
-                    else {
-                        DEBUGPRINTF("Keep free variable %d\n",var);
-                    }
-                    freevar = freevar->next;
-                }   // for
-            
-                DeleteSet(freevarscopy);
-    
-                if (backtrack == 1) break;       // a variable has no options; goto backtrack
-            }       // while freevars->count != lastcount
-            
-            if (backtrack == 1) continue;       // a variable has no options; goto backtrack
+            // fix all variables for which only one literal can be propagated
+            PERF_PHASE(s, PERF_PROBE)
+            int probed = ProbeFreeVariables(s, start);
+            if (probed == LIMIT_REACHED) {
+                LOG("limit\n")
+                s->gResume = 0;
+                return LIMIT_REACHED;
+            }
+            if (probed == 0) {
+                backtrack = 1;      // a variable has no options; goto backtrack
+                continue;
+            }
             
 
             //DEBUGPRINTF("s->gFreeVars.count=%d\n",s->gFreeVars->count);
@@ -792,27 +1270,20 @@ int NextSolution(Solver* s) {
             }
             else
             {
-                // before making a choice, order free variables (if any order specified)
-                Node* ordervar = s->ordered->first;
-                while (ordervar) {
-                    int var = ordervar->value;
-                    if (GetSetNode(s->gFreeVars, var)) {
-                        RemSet(s->gFreeVars, var);
-                        AddSet(s->gFreeVars, var, TRUE);       // true means add to front!
-                        break;      // only the first free var will be used here; no need to continue
-                    }
-                    ordervar = ordervar->next;
-                } 
+                // ranked variables are chosen first (the ordered variables, and the
+                // projected variables, so that the choices of other variables are always 
+                // above the projected choices on the stack)
+                PERF_PHASE(s, PERF_DECIDE)
+                int choicevar = s->gFreeVars->first->value;
+                if (s->gHeapSize > 0) choicevar = s->gHeap[0];
 
                 // statistics
                 s->gNumChoice++;
                 // try negative value for any variable with more than one option
                 // (positive will be done by next backtrack)
-                int var = -s->gFreeVars->first->value;
+                int var = -choicevar;
                 // push on stack
-                Node* newstack = NewNode(+var);
-                newstack->next = s->gStack;  
-                s->gStack = newstack;
+                PushStack(s, +var);
                 // propagate and recurse
                 s->gColor ++;
                 int success = Propagate(s, +var, s->gColor, TRUE);
@@ -838,16 +1309,323 @@ int NextSolution(Solver* s) {
 
 }
 
+// records the statistics at the start of a call
+void StartCall(Solver* s, CallStart* start) {
+    start->numprop = s->gNumProp;
+    start->numchoice = s->gNumChoice;
+    start->time = WallTime();
+    start->seconds = s->gSeconds;
+}
+
+// searches for the next solution, within the call limits counted from start
+int SearchStep(Solver* s, CallStart* start) {
+    double time = WallTime();
+    int result = Search(s, start);
+    PERF_PHASE(s, PERF_NONE)
+    s->gSeconds += WallTime() - time;
+    s->gLastResult = result;
+    if (result == SOLUTION_FOUND && s->gProjection != NULL) s->gSkipAlternatives = 1;
+    return result;
+}
+
+int NextSolution(Solver* s) {
+    CallStart start;
+    StartCall(s, &start);
+    return SearchStep(s, &start);
+}
+
+long EnumerateSolutions(Solver* s, SolutionCallback callback, void* userdata, long limit) {
+    SolutionView view;
+    view.markers = s->gMarkers;
+    view.numberOfVariables = s->gNumberOfVariables;
+    view.index = 0;
+    while (limit <= 0 || view.index < limit) {
+        if (NextSolution(s) != SOLUTION_FOUND) break;
+        view.index++;
+        if (callback != NULL && !callback(&view, userdata)) break;
+    }
+    return view.index;
+}
+
+// ------------- optimization ----------- 
+
+// undo all choices and fixes above the floor; the next search starts forward
+void RestartSearch(Solver* s) {
+    while (s->gDepth > s->gFloor) PopStack(s);
+    s->gResume = 0;
+    s->gResumeVar = 0;
+    s->gSkipAlternatives = 0;
+}
+
+// adds literal as an assumption, i.e. a fix below the floor
+// returns zero, and does not add it, if it conflicts with the previous assumptions  
+int Assume(Solver* s, int lit) {
+    RestartSearch(s);
+    s->gColor+=1;
+    PushStack(s, lit + FIXOFFSET(s));
+    if (!Propagate(s, lit, s->gColor, TRUE)) {
+        PopStack(s);
+        return 0;
+    }
+    s->gFloor = s->gDepth;
+    return 1;
+}
+
+// removes the last assumption
+void Unassume(Solver* s) {
+    RestartSearch(s);
+    s->gFloor--;
+    PopStack(s);
+}
+
+void ClearAssumptions(Solver* s) {
+    s->gFloor = 0;
+    RestartSearch(s);
+}
+
+int Optimize(Solver* s, Objective* objectives, int count) {
+    int result = SOLUTION_FOUND;
+    int atsolution = 0;     // solver is at a solution with all decided bits
+    int o;
+    // the call limits bound the whole optimization, not each search
+    CallStart start;
+    StartCall(s, &start);
+    for (o=0;o<count;o++) {
+        int* literals = objectives[o].literals;
+        // a solution to start from
+        if (!atsolution) {
+            RestartSearch(s);
+            result = SearchStep(s, &start);
+            if (result != SOLUTION_FOUND) return result;
+            atsolution = 1;
+        }
+        int n = 0;
+        while (literals[n] != 0) n++;
+        // bits of the best solution so far
+        int* best = (int*)malloc((n+1)*sizeof(int));
+        int i,j;
+        for (i=0;i<n;i++) best[i] = (s->gMarkers[Literal2Index(literals[i])] != 0);
+        for (i=0;i<n;i++) {
+            int lit = literals[i];
+            // the sign bit has the opposite preference
+            int prefer = (objectives[o].maximize != 0);
+            if (i == 0 && objectives[o].isSigned) prefer = !prefer;
+            if (best[i] != prefer) {
+                // is there a better solution, with the preferred bit?
+                result = SEARCH_EXHAUSTED;
+                if (Assume(s, prefer ? +lit : -lit)) {
+                    result = SearchStep(s, &start);
+                    if (result == SEARCH_EXHAUSTED) Unassume(s);
+                }
+                if (result == LIMIT_REACHED) {
+                    free(best);
+                    return result;
+                }
+                if (result == SOLUTION_FOUND) {
+                    for (j=i;j<n;j++) best[j] = (s->gMarkers[Literal2Index(literals[j])] != 0);
+                    atsolution = 1;
+                    continue;
+                }
+            }
+            // the best solution has this bit (the previous assumptions remain satisfiable)
+            int assumed = Assume(s, best[i] ? +lit : -lit);
+            if (!assumed) {
+                free(best);
+                s->gLastResult = SEARCH_FAILED;
+                return SEARCH_FAILED;
+            }
+            atsolution = 0;
+        }
+        free(best);
+    }
+    if (!atsolution) {
+        RestartSearch(s);
+        result = SearchStep(s, &start);
+    }
+    return result;
+}
+
+void EnableRuleStatistics(Solver* s) {
+    if (s->gRuleStatistics != NULL) return;
+    s->gRuleStatistics = (RuleStatistics*)calloc(s->gNumberOfRules, sizeof(RuleStatistics));
+    s->gMemory += s->gNumberOfRules * sizeof(RuleStatistics);
+}
+
+void SetProjection(Solver* s, int* vars) {
+    if (s->gProjection != NULL) {
+        free(s->gProjection);
+        free(s->gProjected);
+        s->gMemory -= (s->gNumberOfVariables+1) * 2 * sizeof(int);
+    }
+    s->gProjection = NULL;
+    s->gProjected = NULL;
+    s->gSkipAlternatives = 0;
+    if (vars == NULL) {
+        RankVariables(s);
+        return;
+    }
+    s->gProjection = (int*)malloc((s->gNumberOfVariables+1)*sizeof(int));
+    s->gProjected = (int*)calloc(s->gNumberOfVariables+1, sizeof(int));
+    s->gMemory += (s->gNumberOfVariables+1) * 2 * sizeof(int);
+    // copy, without duplicates and invalid variables
+    int n = 0;
+    while (*vars != 0) {
+        int var = abs(*vars++);
+        if (var <= s->gNumberOfVariables && !s->gProjected[var]) {
+            s->gProjected[var] = 1;
+            s->gProjection[n++] = var;
+        }
+    }
+    s->gProjection[n] = 0;
+    RankVariables(s);
+}
+
+void SetLimits(Solver* s, Limits* solverlimits, Limits* calllimits) {
+    if (solverlimits != NULL)
+        s->gSolverLimits = *solverlimits;
+    else
+        memset(&s->gSolverLimits, 0, sizeof(Limits));
+    if (calllimits != NULL)
+        s->gCallLimits = *calllimits;
+    else
+        memset(&s->gCallLimits, 0, sizeof(Limits));
+}
+
+void InterruptSolver(Solver* s) {
+    atomic_store(&s->gInterrupt, 1);
+}
+
+// ------------- checkpoints ----------- 
+
+// format version written by SaveSolverState
+#define STATE_VERSION 3
+
+int SaveSolverState(Solver* s, FILE* file) {
+    // stack is last in first out; write it bottom up
+    int depth = 0;
+    Node* node = s->gStack;
+    while (node) {
+        depth++;
+        node = node->next;
+    }
+    int* values = (int*)malloc((depth+1)*sizeof(int));
+    int i = depth;
+    node = s->gStack;
+    while (node) {
+        values[--i] = node->value;
+        node = node->next;
+    }
+    fprintf(file, "bps-state %d\n", STATE_VERSION);
+    fprintf(file, "%d %d %u\n", s->gNumberOfVariables, s->gNumberOfRules, s->gChecksum);
+    fprintf(file, "%d %d %f %d %d\n", s->gNumProp, s->gNumChoice, s->gSeconds, s->gResume, s->gSkipAlternatives);
+    fprintf(file, "%d %d\n", depth, s->gFloor);
+    for (i=0;i<depth;i++) {
+        fprintf(file, "%d%c", values[i], (i%16==15 || i==depth-1) ? '\n' : ' ');
+    }
+    free(values);
+    // the free variables that a stopped probing pass has yet to probe
+    int remaining = 0;
+    Node* freevar = GetSetNode(s->gFreeVars, s->gResumeVar);
+    for (node=freevar; node; node=node->next) remaining++;
+    fprintf(file, "%d %d\n", s->gResumeCount, remaining);
+    for (i=0, node=freevar; node; node=node->next, i++) {
+        fprintf(file, "%d%c", node->value, (i%16==15 || i==remaining-1) ? '\n' : ' ');
+    }
+    fflush(file);
+    return !ferror(file);
+}
+
+int LoadSolverState(Solver* s, FILE* file) {
+    int version, numvars, numrules, numprop, numchoice, resume, skip, depth, floor;
+    unsigned int checksum;
+    double seconds;
+    if (fscanf(file, " bps-state %d", &version) != 1 || version != STATE_VERSION) return 0;
+    if (fscanf(file, "%d %d %u", &numvars, &numrules, &checksum) != 3) return 0;
+    if (numvars != s->gNumberOfVariables || numrules != s->gNumberOfRules || checksum != s->gChecksum) {
+        // state of a different problem
+        return 0;
+    }
+    if (fscanf(file, "%d %d %lf %d %d", &numprop, &numchoice, &seconds, &resume, &skip) != 5) return 0;
+    if (fscanf(file, "%d %d", &depth, &floor) != 2 || depth < 0 || depth > numvars) return 0;
+    if (floor < 0 || floor > depth) return 0;
+    int* values = (int*)malloc((depth+1)*sizeof(int));
+    int i;
+    for (i=0;i<depth;i++) {
+        if (fscanf(file, "%d", &values[i]) != 1) {
+            free(values);
+            return 0;
+        }
+    }
+
+    int resumecount, remaining;
+    if (fscanf(file, "%d %d", &resumecount, &remaining) != 2 || remaining < 0 || remaining > numvars) {
+        free(values);
+        return 0;
+    }
+    int* freevars = (int*)malloc((remaining+1)*sizeof(int));
+    for (i=0;i<remaining;i++) {
+        if (fscanf(file, "%d", &freevars[i]) != 1 || freevars[i] < 1 || freevars[i] > numvars) {
+            free(values);
+            free(freevars);
+            return 0;
+        }
+    }
+
+    // start from an empty stack
+    s->gFloor = 0;
+    while (s->gStack != NULL) PopStack(s);
+    s->gResumeVar = 0;
+
+    // replay the choices and fixes, each with its own color
+    for (i=0;i<depth;i++) {
+        int lit = StackLiteral(s, values[i]);
+        if (lit == 0 || abs(lit) > s->gNumberOfVariables) break;
+        s->gColor+=1;
+        PushStack(s, values[i]);
+        if (!Propagate(s, lit, s->gColor, TRUE)) break;
+    }
+    free(values);
+    if (i < depth) {
+        // inconsistent state; back to the start of the search
+        while (s->gStack != NULL) PopStack(s);
+        free(freevars);
+        return 0;
+    }
+
+    // a stopped probing pass continues with the remaining variables, 
+    // so move them to the end of the free variables
+    for (i=0;i<remaining;i++) {
+        if (GetSetNode(s->gFreeVars, freevars[i]) != NULL) {
+            RemSet(s->gFreeVars, freevars[i]);
+            AddSet(s->gFreeVars, freevars[i], FALSE);
+            if (s->gResumeVar == 0) s->gResumeVar = freevars[i];
+        }
+    }
+    s->gResumeCount = resumecount;
+    free(freevars);
+
+    // statistics and search mode
+    s->gNumProp = numprop;
+    s->gNumChoice = numchoice;
+    s->gSeconds = seconds;
+    s->gResume = resume;
+    s->gSkipAlternatives = (skip && s->gProjection != NULL);
+    s->gFloor = floor;
+    return 1;
+}
+
 
 Solver* NewSolver(int* problem) {
     Solver* s = (Solver*)malloc(sizeof(Solver));
     init(s, problem);
+    if (getenv("BPS_PERF_COUNTERS") != NULL) EnablePerfCounters(s);
     return s;
 }
 
 Solver* NewSolver2(int* problem, List* ordered) {
     Solver* s = (Solver*)malloc(sizeof(Solver));
     init(s, problem);
+    if (getenv("BPS_PERF_COUNTERS") != NULL) EnablePerfCounters(s);
     // copy variable ordering to solver
     if (ordered) {
         Node* var = ordered->first;
@@ -855,6 +1633,7 @@ Solver* NewSolver2(int* problem, List* ordered) {
             ListAppend(s->ordered, var->value);
             var = var->next;
         }
+        RankVariables(s);
     }
     return s;
 }
@@ -881,14 +1660,23 @@ void DeleteSolver(Solver* s) {
         }
         if (s->gC2N != NULL) free(s->gC2N);
         DeleteSet(s->gFreeVars);
+        if (s->gProjection != NULL) free(s->gProjection);
+        if (s->gProjected != NULL) free(s->gProjected);
+        free(s->gRank);
+        free(s->gHeap);
+        free(s->gHeapPos);
+        if (s->gRuleStatistics != NULL) free(s->gRuleStatistics);
+        if (s->gPerf != NULL) DisablePerfCounters(s);
         // stack of previous guesses 
-        // Node* gStack;
+        ReleasePool(&s->gStackPool);
+        DeleteList(s->ordered);
         free(s);
     }
 }
 
 
 int GetNumber (Solver* s, int* literals) {
+    PERF_PHASE(s, PERF_EXTRACT)
     int number = 0;
     int lit; 
     int index = 0;
@@ -898,6 +1686,117 @@ int GetNumber (Solver* s, int* literals) {
         // if literal in solution, add 1
         if (s->gMarkers[Literal2Index(lit)]!=0) ++number;
     } 
+    PERF_PHASE(s, PERF_NONE)
+    return number;
+}
+
+int GetSignedNumber (Solver* s, int* literals) {
+    PERF_PHASE(s, PERF_EXTRACT)
+    int number = 0;
+    int index = 0;
+    // get sign bit
+    int lit = literals[index++];
+    int negative = (s->gMarkers[Literal2Index(lit)]!=0);
+    // get value
+    if (negative) {
+        while ((lit = literals[index++])!=0) {
+            // shift right
+            number <<= 1;
+            // if literal NOT in solution, add 1    - two's complement, invert bits
+            if (s->gMarkers[Literal2Index(lit)]==0) ++number;
+        } 
+        number = -(number+1);    // two's complement - add 1
+    }
+    else    // positive
+    {
+        while ((lit = literals[index++])!=0) {
+            // shift right
+            number <<= 1;
+            // if literal in solution, add 1
+            if (s->gMarkers[Literal2Index(lit)]!=0) ++number;
+        } 
+    }
+    PERF_PHASE(s, PERF_NONE)
     return number;
 }
 
+// ------------- number layout ----------- 
+
+NumberLayout* NewNumberLayout() {
+    NumberLayout* layout = (NumberLayout*)malloc(sizeof(NumberLayout));
+    layout->count = 0;
+    layout->capacity = 16;
+    layout->width = (int*)malloc(layout->capacity*sizeof(int));
+    layout->isSigned = (int*)malloc(layout->capacity*sizeof(int));
+    layout->first = (int*)malloc(layout->capacity*sizeof(int));
+    layout->numindices = 0;
+    layout->indexcapacity = 64;
+    layout->indices = (int*)malloc(layout->indexcapacity*sizeof(int));
+    return layout;
+}
+
+int AddLayoutNumber(NumberLayout* layout, int* literals, int isSigned) {
+    int width = 0;
+    while (literals[width] != 0) width++;
+    if (width > 64) return -1;
+    // grow arrays
+    if (layout->count == layout->capacity) {
+        layout->capacity *= 2;
+        layout->width = (int*)realloc(layout->width, layout->capacity*sizeof(int));
+        layout->isSigned = (int*)realloc(layout->isSigned, layout->capacity*sizeof(int));
+        layout->first = (int*)realloc(layout->first, layout->capacity*sizeof(int));
+    }
+    while (layout->numindices + width > layout->indexcapacity) {
+        layout->indexcapacity *= 2;
+        layout->indices = (int*)realloc(layout->indices, layout->indexcapacity*sizeof(int));
+    }
+    // store literals as marker indices
+    layout->width[layout->count] = width;
+    layout->isSigned[layout->count] = isSigned;
+    layout->first[layout->count] = layout->numindices;
+    int i;
+    for (i=0;i<width;i++) {
+        layout->indices[layout->numindices++] = Literal2Index(literals[i]);
+    }
+    return layout->count++;
+}
+
+void DeleteNumberLayout(NumberLayout* layout) {
+    if (layout != NULL) {
+        free(layout->width);
+        free(layout->isSigned);
+        free(layout->first);
+        free(layout->indices);
+        free(layout);
+    }
+}
+
+void GetNumbers(Solver* s, const NumberLayout* layout, int64_t* out) {
+    PERF_PHASE(s, PERF_EXTRACT)
+    const int* markers = s->gMarkers;
+    const int* index = layout->indices;
+    int n;
+    for (n=0;n<layout->count;n++) {
+        int width = layout->width[n];
+        // gather the bits in a word, most significant bit first
+        uint64_t bits = 0;
+        int i = 0;
+        for (;i+4<=width;i+=4) {
+            bits = (bits << 4) 
+                | ((uint64_t)(markers[index[i]]!=0) << 3)
+                | ((uint64_t)(markers[index[i+1]]!=0) << 2)
+                | ((uint64_t)(markers[index[i+2]]!=0) << 1)
+                | ((uint64_t)(markers[index[i+3]]!=0));
+        }
+        for (;i<width;i++) {
+            bits = (bits << 1) | (uint64_t)(markers[index[i]]!=0);
+        }
+        index += width;
+        // two's complement: extend sign bit
+        if (layout->isSigned[n] && width > 0 && width < 64) 
+            out[n] = (int64_t)(bits << (64-width)) >> (64-width);
+        else
+            out[n] = (int64_t)bits;
+    }
+    PERF_PHASE(s, PERF_NONE)
+}
@@ -0,0 +1,61 @@
+/*  Allocation profiling for the Boolean Propagation Solver and SillyCon
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    ----
+
+    Usage:
+
+    If ALLOC_PROFILE is defined (make alloc-profile), malloc, calloc, realloc
+    and free are replaced by counting versions (core/alloc_profile.c) in all
+    files that include bps.h. ALLOC_PHASE names the phase of the program that
+    following allocations belong to, and ALLOC_REPORT prints the number of
+    allocations, bytes and peak live bytes per phase, and the allocations and
+    bytes per call site. Without ALLOC_PROFILE these macros do nothing.
+
+    ----
+*/
+
+#ifndef INCLUDE_ALLOC_PROFILE
+#define INCLUDE_ALLOC_PROFILE
+
+#ifdef ALLOC_PROFILE
+
+// the standard declarations come first, so they are not replaced
+#include <stdio.h>
+#include <stdlib.h>
+
+void* ProfileMalloc(size_t size, const char* file, int line, const char* func);
+void* ProfileCalloc(size_t count, size_t size, const char* file, int line, const char* func);
+void* ProfileRealloc(void* ptr, size_t size, const char* file, int line, const char* func);
+void ProfileFree(void* ptr);
+void ProfilePhase(const char* name);
+void ProfileReport(FILE* file);
+
+#define malloc(size) ProfileMalloc(size, __FILE__, __LINE__, __func__)
+#define calloc(count, size) ProfileCalloc(count, size, __FILE__, __LINE__, __func__)
+#define realloc(ptr, size) ProfileRealloc(ptr, size, __FILE__, __LINE__, __func__)
+#define free(ptr) ProfileFree(ptr)
+
+#define ALLOC_PHASE(name) ProfilePhase(name);
+#define ALLOC_REPORT(file) ProfileReport(file);
+
+#else
+
+#define ALLOC_PHASE(name)
+#define ALLOC_REPORT(file)
+
+#endif
+
+#endif
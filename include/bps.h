@@ -30,6 +30,9 @@
 #ifndef INCLUDE_BPS
 #define INCLUDE_BPS
 
+// counting allocation functions, in the allocation profiling build
+#include "alloc_profile.h"
+
 // if LOG_PROPAGATIONS is defined, then all propagations are written to a log file
 
 //#define LOG_PROPAGATIONS
@@ -40,6 +43,8 @@
     #define  LOG(...)
 #endif
  
+#include <stdio.h>
+
 // the details of these types or not interesting to most API users
 #include "bps_types.h"
 
@@ -67,13 +72,111 @@ Solver* NewSolver2(int* problem, List* ordered);
 /* Destructor. Frees allocated memory. */
 void DeleteSolver(Solver* s);
 
+// return values of NextSolution
+#define SOLUTION_FOUND       1
+#define SEARCH_EXHAUSTED     0
+#define LIMIT_REACHED       -1
+#define SEARCH_FAILED       -2      // Optimize could not fix a bit of its best solution
+
 /* Searches for the next solution.
    Note that this function must be called at least once, to determine the
     first solution, or to determine that there are no solutions. 
-   Returns 1 if a new solution is found; 0 if there are no more solutions
+   Returns SOLUTION_FOUND (1) if a new solution is found; SEARCH_EXHAUSTED (0)
+   if there are no more solutions; LIMIT_REACHED (-1) if a resource limit was
+   reached or the solver was interrupted before the search could decide. 
+   In the latter case the search state is kept, and the next call resumes 
+   the search where it stopped.
 */
 int NextSolution(Solver* s);
 
+/* Fixes all variables for which only one literal can be propagated, 
+   without making choices (the first step of NextSolution). 
+   Returns zero if a variable has no possible literals, i.e. there are no solutions.
+*/
+int Probe(Solver* s);
+
+/* Searches for solutions and calls callback for each of them, with a view of
+   the solution and the given userdata. Stops when the callback returns zero,
+   after limit solutions (if limit > 0), or when NextSolution does not find 
+   a solution. The callback may be NULL to just count solutions.
+   Returns the number of solutions found. Solver.gLastResult tells whether
+   the search is exhausted or a resource limit was reached. The search can be
+   continued by calling EnumerateSolutions or NextSolution again.
+*/
+long EnumerateSolutions(Solver* s, SolutionCallback callback, void* userdata, long limit);
+
+/* Projects the solutions onto the given variables (zero terminated array). 
+   NextSolution then finds each distinct assignment of these variables once,
+   with a single completion of the other variables. 
+   Projected variables are chosen before any other variables, so this must
+   be called before the first call of NextSolution. NULL clears the projection.
+*/
+void SetProjection(Solver* s, int* vars);
+
+/* Finds an optimal solution for the given objectives, in lexicographic order:
+   each objective is optimized among the optimal solutions for the previous ones.
+   The objective bits are decided most significant first. The value of a bit
+   is only searched for if the best solution so far does not already have the 
+   preferred value, and each decided bit becomes an assumption that bounds 
+   all later searches in the same solver.
+   Returns SOLUTION_FOUND if the solver is at an optimal solution, 
+   SEARCH_EXHAUSTED if there are no solutions, LIMIT_REACHED, or SEARCH_FAILED
+   if the bits of the best solution found could not be assumed (an internal
+   error). The call limits (see SetLimits) bound the whole call, not each search.
+   The assumptions are kept, so NextSolution then finds the other optimal
+   solutions. ClearAssumptions removes them, and restarts the search. 
+   After LIMIT_REACHED or SEARCH_FAILED, ClearAssumptions must be called
+   before optimizing again.
+*/
+int Optimize(Solver* s, Objective* objectives, int count);
+void ClearAssumptions(Solver* s);
+
+/* Sets resource limits. The solver limits bound the totals over all calls 
+   of NextSolution (the memory limit bounds the memory allocated by the solver).
+   The call limits bound each single call of NextSolution, or of Optimize. 
+   A NULL pointer, or a zero field, means unlimited. 
+*/
+void SetLimits(Solver* s, Limits* solverlimits, Limits* calllimits);
+
+/* Counts rule firings, propagations and conflicts per rule from now on, 
+   in Solver.gRuleStatistics (one entry per rule, in the order of the rules
+   in the problem). Costs some time in each propagation.
+*/
+void EnableRuleStatistics(Solver* s);
+
+/* Reads hardware performance counters (cycles, instructions, cache misses,
+   branch misses and page faults) per phase of the search: probing, decisions,
+   backtracking and extracting numbers from solutions (Linux perf_event_open).
+   Reading the counters costs time in every phase.
+   Returns the number of counters that are available; zero if none (the 
+   solver then works as usual). Counters are enabled in every new solver if 
+   the environment variable BPS_PERF_COUNTERS is set.
+   WritePerfCounters writes a line per available counter: the total count, the 
+   name of the counter, and the counts per phase. It writes nothing if not enabled.
+*/
+int EnablePerfCounters(Solver* s);
+void WritePerfCounters(Solver* s, FILE* file);
+
+/* Requests the solver to stop searching. Can be called from another thread
+   or a signal handler. A running (or the next) call of NextSolution returns
+   LIMIT_REACHED as soon as possible and clears the request.
+*/
+void InterruptSolver(Solver* s);
+
+/* Checkpoints.
+   SaveSolverState writes the state of the search to a file: the stack of 
+   choices and fixes (not the complete solution), statistics, a checksum 
+   of the problem, and the variables that an interrupted probing step has
+   yet to examine. LoadSolverState restores a saved state in a solver for 
+   the same problem (possibly in another process) by replaying the choices 
+   and fixes. The search then continues where the saved search was. 
+   The remaining solutions are the same, but may be found in a different order.
+   Both return non-zero on success. LoadSolverState fails and leaves the 
+   solver at the start of the search if the state does not match the problem.
+*/
+int SaveSolverState(Solver* s, FILE* file);
+int LoadSolverState(Solver* s, FILE* file);
+
 /* Get a number from the solution.
    A number is defined by a zero-terminated list of literals, most significant
    bit first.  For a single literal the function returns 1 if it is in the
@@ -81,4 +184,20 @@ int NextSolution(Solver* s);
 */
 int GetNumber(Solver* s, int* literals);
 
+/* Like GetNumber, but the first literal is the sign bit of a two's complement number. */
+int GetSignedNumber(Solver* s, int* literals);
+
+/* Batched number extraction.
+   A NumberLayout is created once for a problem and defines a sequence of
+   numbers. AddLayoutNumber adds a number, defined by a zero-terminated list
+   of at most 64 literals (most significant bit first, as for GetNumber), 
+   and returns its position in the layout, or -1 if it has too many literals.
+   GetNumbers reads all numbers of the layout from the current solution and
+   stores them in out, which must have room for layout->count numbers. 
+*/
+NumberLayout* NewNumberLayout();
+int AddLayoutNumber(NumberLayout* layout, int* literals, int isSigned);
+void DeleteNumberLayout(NumberLayout* layout);
+void GetNumbers(Solver* s, const NumberLayout* layout, int64_t* out);
+
 #endif
@@ -14,6 +14,9 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdatomic.h>
+#include <stdint.h>
+
 // --------- defines -----
 
 //#define DEBUGPRINTF(...) printf(__VA_ARGS__)
@@ -31,6 +34,22 @@ typedef struct {
 
 Node* NewNode (int value);
 
+// ------ pool of nodes ----
+// Each Set and List (and the decision stack of a Solver) owns a pool of nodes.
+// Nodes are allocated in slabs of growing size, removed nodes are reused,
+// and all slabs are released at once when the owner is deleted.
+
+typedef struct {
+    Node* free;         // removed nodes, linked by next
+    void* slab;         // (NodeSlab*) last allocated slab, linked to the previous ones
+    int used;           // nodes handed out from the last slab
+} NodePool;
+
+void InitPool (NodePool* pool);
+Node* PoolNode (NodePool* pool, int value);
+void PoolFree (NodePool* pool, Node* node);
+void ReleasePool (NodePool* pool);
+
 // ------ set of integers ----
 // A set of integers, up to a given number (0 <= value < capacity).
 // Implemented as a double ended queue and a map from values to nodes.
@@ -46,6 +65,7 @@ typedef struct {
     Node* first;
     Node* last;
     Node** value2node;
+    NodePool pool;
 } Set;
 
 Node* GetSetNode (Set* set, int value); 
@@ -65,6 +85,7 @@ typedef struct {
     int count;
     Node* first;
     Node* last;
+    NodePool pool;
 } List;
 
 List* NewList (); 
@@ -73,7 +94,82 @@ Node* ListAppend (List* list, int value);
 Node* ListPrepend (List* list, int value); 
 int ListPopEnd (List* list); 
 int ListPopFront (List* list); 
+// copies the values to a new array, followed by two zeros; NULL if the list is empty
+int* List2Array(List* l);
+
+// ------ buffer of integers ----
+// A growable array of integers, for building the input of a solver.
+// The capacity doubles when full, so append costs O(1) amortized.
+// BufferArray returns the values followed by two zeros, without copying.
 
+typedef struct {
+    int count;          // number of values
+    int capacity;       // allocated values, excluding the two terminating zeros
+    int* values;
+} Buffer;
+
+Buffer* NewBuffer (int capacity);
+void DeleteBuffer (Buffer* buffer);
+void BufferAppend (Buffer* buffer, int value);
+Buffer* CopyBuffer (Buffer* buffer);
+int* BufferArray (Buffer* buffer);
+
+
+// ------ number layout ----
+// A precompiled description of a sequence of numbers in a solution, read by GetNumbers.
+// Each number is a list of literals, most significant bit first, at most 64 bits.
+// The literals are stored as indices in Solver.gMarkers (see Literal2Index) 
+// in one array, so reading the numbers needs no conversions or allocations.
+
+typedef struct {
+    int count;          // number of numbers
+    int capacity;       // allocated numbers
+    int* width;         // number of bits of each number 
+    int* isSigned;      // non-zero for two's complement numbers
+    int* first;         // position in indices of the most significant bit of each number
+    int numindices;     // number of indices
+    int indexcapacity;  // allocated indices
+    int* indices;       // marker indices of the literals of all numbers
+} NumberLayout;
+
+// ------ resource limits ----
+// A budget for the search. A value of zero means unlimited.
+
+typedef struct {
+    long propagations;  // max number of propagations
+    long choices;       // max number of choices
+    double seconds;     // max wall clock time spent in NextSolution
+    long memory;        // max number of bytes allocated by the solver
+} Limits;
+
+// ------ rule statistics ----
+// Counted per rule while searching, if enabled (see EnableRuleStatistics).
+
+typedef struct {
+    long firings;       // number of times all lhs literals were in the solution
+    long propagations;  // number of rhs literals propagated by the rule
+    long conflicts;     // number of rhs literals that conflicted with the solution
+} RuleStatistics;
+
+// ------ performance counters ----
+// Hardware counters per phase of the search, if enabled (see EnablePerfCounters).
+
+#define NUM_PERF_COUNTERS   5   // cycles, instructions, cache misses, branch misses, page faults
+#define NUM_PERF_PHASES     4
+
+// phases; counts outside these phases are not attributed
+#define PERF_NONE       -1
+#define PERF_PROBE      0       // fixing variables without choices (see Probe)
+#define PERF_DECIDE     1       // choosing a literal and propagating it
+#define PERF_BACKTRACK  2       // undoing choices and propagating alternatives
+#define PERF_EXTRACT    3       // reading numbers from a solution (GetNumber and friends)
+
+typedef struct {
+    int fds[NUM_PERF_COUNTERS];                 // file descriptor per counter; -1 if not available
+    long long start[NUM_PERF_COUNTERS];         // counter values at the start of the current phase
+    long long values[NUM_PERF_PHASES][NUM_PERF_COUNTERS];
+    int phase;                                  // current phase
+} PerfCounters;
 
 // ------------ solver ---------
 // visible in the API, but user need not be concerned with the details
@@ -118,8 +214,10 @@ typedef struct {
     // color to use for propagating, corresponds more or less to depth
     int gColor;
 
-    // stack of previous guesses 
+    // stack of previous guesses: choices are stored as the chosen literal,
+    // fixes as the fixed literal + FIXOFFSET
     Node* gStack;
+    NodePool gStackPool;    // nodes of gStack
 
     // statistics - total number of propagations (so far)
     int gNumProp;
@@ -131,9 +229,91 @@ typedef struct {
     // the solver will first find the solution with the minimum value
     // for these variables (most significant first)
     List* ordered;
+
+    // ranked variables are chosen before other variables, lowest rank first:
+    // ordered variables, projected variables first (see SetProjection)
+    // the free ranked variables are kept in a binary heap, ordered by rank
+    int* gRank;         // rank per variable; -1 if not ranked
+    int* gHeap;         // heap of free ranked variables
+    int* gHeapPos;      // position of variable in heap; -1 if not in heap
+    int gHeapSize;
+
+    // resource limits for the lifetime of the solver and for each call of NextSolution
+    Limits gSolverLimits;
+    Limits gCallLimits;
+
+    // total wall clock time spent in NextSolution (so far)
+    double gSeconds;
+
+    // approximate number of bytes allocated by the solver
+    long gMemory;
+
+    // set by InterruptSolver, possibly from another thread
+    atomic_int gInterrupt;
+
+    // checksum of the problem
+    unsigned int gChecksum;
+
+    // search mode (0=forward, 1=backtrack) to resume with after a limit was reached; -1 if none
+    int gResume;
+
+    // result of the last call of NextSolution
+    int gLastResult;
+
+    // projected variables (zero terminated) and a flag per variable; NULL if no projection
+    int* gProjection;
+    int* gProjected;
+
+    // number of entries on the stack, and the number of entries at the bottom 
+    // that are assumptions (see Optimize); backtracking stops at the floor
+    int gDepth;
+    int gFloor;
+
+    // set after a solution in projected mode: backtrack to the last projected choice
+    // without trying the alternatives of other choices 
+    int gSkipAlternatives;
+
+    // statistics per rule, in the order of the rules in the problem; NULL if not enabled
+    RuleStatistics* gRuleStatistics;
+
+    // hardware counters per phase; NULL if not enabled
+    PerfCounters* gPerf;
+
+    // free variable to continue probing with after a limit was reached; 0 if none
+    // and the number of free variables at the start of that probing pass
+    int gResumeVar;
+    int gResumeCount;
  
 } Solver;
 
+// ------------ objective ---------
+// A number to minimize or maximize (see Optimize).
+
+typedef struct {
+    int* literals;      // zero terminated, most significant bit first
+    int isSigned;       // non-zero if the first literal is the sign bit of a two's complement number 
+    int maximize;       // non-zero to maximize, zero to minimize 
+} Objective;
+
+// ------------ solution view ---------
+// A read-only view of a solution, passed to the callback of EnumerateSolutions.
+// It points into the solver, so it is only valid during the callback.
+
+typedef struct {
+    const int* markers;         // Solver.gMarkers; literal index i is in the solution if markers[i] != 0
+    int numberOfVariables;      // variables are 1..numberOfVariables
+    long index;                 // number of the solution, starting at 1
+} SolutionView;
+
+// value (1 or 0) of a variable in a solution view
+#define VIEWVALUE(view, var) ((view)->markers[2*(var)-1] != 0)
+
+// called for each solution; returns non-zero to continue, zero to stop
+typedef int (*SolutionCallback)(const SolutionView* view, void* userdata);
+
+// offset of fixed literals on the stack; makes their values larger than any variable
+#define FIXOFFSET(s) (2*(s)->gNumberOfVariables+1)
+
 // Literal2Index computes index in a literal array from a positive or negative literal value.
 // You'll need these if you want to examine the literals in a solution (i.e. Solver.gMarkers) 
 // Note that value 0 (not a literal) maps to -1
@@ -153,7 +333,7 @@ int OppositeIndex(int index);
 
 
 /* You should probably not use Propagate and Unpropagate directly 
-   But they are here for use by Simplyify in the sillycon program. 
+   But they are here for use by the microbenchmarks (bench/micro.c). 
 */
 
 /* Assign color to given literal and propagate to other literals by following rules. 
@@ -169,4 +349,15 @@ int Propagate(Solver* s, int lv, int color, int updateFreeVars);
 */
 void Unpropagate(Solver* s, int lv, int color, int updateFreeVars);
 
+/* Push a choice, or a fix (literal + FIXOFFSET) on the stack of the solver. 
+   The literal should be propagated with the next color.
+*/
+void PushStack(Solver* s, int value);
+
+/* The literal of a choice or fix on the stack */
+int StackLiteral(Solver* s, int value);
+
+/* Undo the last choice or fix and pop it from the stack */
+void PopStack(Solver* s);
+
 
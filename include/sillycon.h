@@ -0,0 +1,272 @@
+/*  SillyCon: the expression compiler, shared by the interpretor and the tools in bench/
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    ----
+
+    Usage:
+
+    An expression is parsed by parseExpr, and converted to the rules of a
+    Problem by convertExpr, which returns the literals of the value of the
+    expression (most significant bit first). Simplify returns a smaller
+    problem with the same solutions. Numbers are gNumberWidth bits two's
+    complement numbers.
+
+    ----
+*/
+
+#ifndef INCLUDE_SILLYCON
+#define INCLUDE_SILLYCON
+
+#include <stdio.h>
+#include "bps.h"
+
+#define MAX_WORD_LENGTH     255     // buffer for parsing terms
+#define NUMBER_WIDTH    9           // default size of numbers in bits
+#define MAX_SOLUTIONS   100         // max number of solutions of subproblems, and default for printing
+#define WRITER_BUFFER   (1<<20)     // size of the buffer of the solution writer
+
+typedef enum {VAR,NUM,                   // terminals
+    NOT,NEG,                             // unary operators
+    EQ,AND,OR,XOR,IMPL,                    // binary operators (logic)
+    ADD,SUB,MUL,DIV,MOD,                 // binary operators (artihmetic)
+    LT,GT,                               // binary operators (comparisons)
+    EVAL,MIN,MAX,IND,                    // special solvers (binary)
+    COUNT,                               // counting solver (unary)
+    CON,                                 // constrain equal 1 (unuary)
+    PNTR,                                 // a pointer to a variable
+    SHL                                  // shift left by a constant (made by rewriteExpr)
+} Operator;
+
+typedef struct {
+    Operator op;
+    char* term;
+    void* left;
+    void* right;
+    int refs;               // number of references to the expression (see newExpr)
+} Expr;
+
+// ------ input ----
+// A Lexer reads the input from a buffer: a regular file is mapped in memory
+// (or read at once), other files (a terminal or pipe) are read as the data
+// arrives, so interactive input is parsed as soon as an expression is complete.
+
+typedef struct {
+    int fd;                 // file read as the data arrives; -1 if all input is in the buffer
+    char* buffer;
+    long length;            // number of characters in the buffer
+    long pos;               // position of the next character
+    int mapped;             // non-zero if the buffer is mapped with mmap
+    int owned;              // non-zero if the buffer was allocated by the lexer
+    int eof;                // set when reading past the end of the input
+    int line;               // line and column of the next character, from 1
+    int column;
+    int tokenline;          // line and column of the last term
+    int tokencolumn;
+} Lexer;
+
+// ------ variables ----
+// A variable is a single letter, a long name in brackets ([name], stored without
+// the brackets), or a numbered variable ?N (made by makeVarName). The symbol table
+// keeps the variables in order of definition, with a hash index on the names.
+
+typedef struct {
+    char* name;
+    int firstlit;           // first of the gNumberWidth literals of the variable
+} Symbol;
+
+typedef struct {
+    int count;
+    int capacity;
+    Symbol* symbols;        // in order of definition
+    int hashsize;           // a power of two, at least twice the capacity
+    int* hash;              // index+1 of the symbol with the name, or zero
+} SymbolTable;
+
+// ------ gates ----
+// The boolean gates of a problem are hashed on their kind and inputs, so a gate
+// over the same inputs is encoded once (makeBoolAnd and the other makeBool encoders).
+// OR is stored as a negated AND, EQ as a negated XOR, and the inputs of XOR as 
+// positive literals.
+
+typedef enum {GATE_AND = 1, GATE_XOR, GATE_IMPL} GateKind;
+
+typedef struct {
+    int kind;               // GateKind; zero if the slot is empty
+    int left;               // inputs, left <= right for AND and XOR
+    int right;
+    int out;                // output literal
+} Gate;
+
+typedef struct {
+    int count;
+    int size;               // a power of two, at least twice the count
+    Gate* gates;
+} GateTable;
+
+// ------ conversions ----
+// The literals of each shared expression (referenced more than once) are kept 
+// per problem by convertExpr, so it is converted once.
+
+typedef struct {
+    Expr* expr;             // NULL if the slot is empty
+    List* literals;
+} Conversion;
+
+typedef struct {
+    int count;
+    int size;               // zero, or a power of two, at least twice the count
+    Conversion* entries;
+} ConversionTable;
+
+typedef struct {
+    int maxlit;         // highest used literal
+    Buffer* rules;      // all the rules in the form of literals with zeros to terminate clauses; the solver input
+    int numrules;       // number of rules
+    Buffer* tags;       // profile entry (or -1) per rule, if profiling; NULL otherwise
+    SymbolTable symbols;    // the variables
+    GateTable gates;    // the boolean gates, by kind and inputs
+    ConversionTable conversions;    // the literals of the converted shared expressions
+    int true;           // literal that is true (always in the solution)
+    int false;          // literal that is false (never in the solution)
+} Problem;
+
+// ------ profile ----
+// If gProfiling is set, convertExpr records an entry for each expression node,
+// and each new rule is tagged with the entry of the node that added it.
+
+typedef struct {
+    Expr* expr;
+    int parent;             // entry of the parent node; -1 if none
+    int depth;
+    double seconds;         // time spent converting the subtree, including subproblems
+    long literals;          // literals added by the subtree (to the problem it was converted in)
+    long rules;             // rules added by the subtree
+    // set by printProfile, for the subtree
+    long solverrules;       // rules in the solver of the problem, after Simplify
+    long firings;
+    long propagations;
+    long conflicts;
+} ProfileEntry;
+
+// ------ output ----
+// A Writer collects formatted text in a buffer, which grows as needed and is
+// written to the file by flushWriter. An OutputPlan is compiled once per problem:
+// the names of the variables in output order and a NumberLayout of their literals,
+// so writing a solution needs no lookups or allocations.
+//
+// Formats of the solutions:
+//  FORMAT_HUMAN    Solution #n: and a line name=value per variable
+//  FORMAT_DELTA    as human, but only the variables that changed since the previous solution
+//  FORMAT_CSV      a header line with the names, then a line of values per solution
+//  FORMAT_JSONL    a JSON object {"name": value, ...} per line
+//  FORMAT_BINARY   a header: 'H', the number of variables (int32), and per variable the 
+//                  length of its name (uint8) and the name; then per solution 'S' and 
+//                  the values (int32). All integers are little-endian.
+// A header is written for each problem.
+
+typedef enum {FORMAT_HUMAN, FORMAT_DELTA, FORMAT_CSV, FORMAT_JSONL, FORMAT_BINARY} OutputFormat;
+
+typedef struct {
+    FILE* file;
+    int count;
+    int capacity;
+    char* buffer;
+} Writer;
+
+typedef struct {
+    OutputFormat format;
+    int count;              // number of variables
+    char** names;           // owned by the problem
+    int* namelengths;
+    NumberLayout* layout;   // the literals of each variable
+    int64_t* values;        // of the last written solution
+    int64_t* previous;      // of the solution before, for FORMAT_DELTA
+    int written;            // number of solutions written
+} OutputPlan;
+
+// resource limits for each solver (main problem and subproblems)
+extern Limits gLimits;
+
+// size of numbers in bits; at least 2
+extern int gNumberWidth;
+
+// if zero, subproblems and Simplify print no progress and statistics
+extern int gVerbose;
+
+// set when a search reached a resource limit (gLimits): the result of the expression
+// is incomplete. Subproblems that reach a limit have no result (NULL).
+extern int gLimitReached;
+
+// profile (set gProfiling before creating the problem)
+extern int gProfiling;
+void startProfile();
+void printProfile(Problem* problem, Solver* solver);
+
+// trace of nested spans of time, in Chrome trace event format
+int openTrace(char* filename);
+void closeTrace();
+double traceStart();
+void traceSpan(const char* name, double start, Solver* solver);
+
+// input
+Lexer* newLexer(FILE* file);
+Lexer* newStringLexer(char* string, long length);
+void deleteLexer(Lexer* lexer);
+
+// expressions
+// expressions are allocated in an arena; deleteExprs releases all of them
+// newExpr returns the existing expression if an equal one was made before, except for EVAL and IND
+Expr* newExpr(Operator op, char* term, Expr* left, Expr* right);
+void deleteExprs();
+// parses the next expression; NULL at the end of the input or on an error
+Expr* parseExpr(Lexer* input);
+void printExpr(Expr* expr, int depth);
+// returns an equivalent expression with fewer nodes; adds the number of eliminated nodes to eliminated
+Expr* rewriteExpr(Expr* expr, int* eliminated);
+
+// problems
+Problem* newProblem();
+void deleteProblem(Problem* p);
+void addRule2(Problem* p, int l1, int l2, int r1, int r2);
+char* makeVarName(int var);
+List* getVariable(Problem* p, char* name);
+// the indices of the symbols in output order: letters and numbered variables by number, then long names
+int* sortedSymbols(Problem* p);
+
+// converts an expression to rules added to the problem; returns the literals of its value, or NULL
+List* convertExpr(Expr* expr, Problem* p);
+
+// returns a new, simplified problem; the literals of expression are mapped in place
+Problem* Simplify(Problem* problem, List* expression);
+
+// output
+Writer* newWriter(FILE* file, int capacity);
+void deleteWriter(Writer* writer);
+void writeString(Writer* writer, const char* string, int length);
+void writeNumber(Writer* writer, int64_t number);
+void flushWriter(Writer* writer);
+// returns the format with the given name (human, delta, csv, jsonl or binary), or -1
+int parseOutputFormat(char* name);
+OutputPlan* newOutputPlan(Problem* p, OutputFormat format);
+void deleteOutputPlan(OutputPlan* plan);
+void writeHeader(Writer* writer, OutputPlan* plan);
+void writeSolution(Writer* writer, OutputPlan* plan, Solver* solver, int number);
+
+// solvers with the resource limits in gLimits
+Solver* newSolver(int* rules, List* ordered);
+int nextSolution(Solver* solver);
+void setProjection(Solver* solver, List* literals);
+
+#endif
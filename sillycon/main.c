@@ -0,0 +1,300 @@
+/*  SillyCon
+
+    Interpretor for a silly constraint language
+
+    Copyright Rick van der Meiden 2013 
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "bps.h"
+#include "sillycon.h"
+
+// -------------------------- main -------------------
+
+int main(int argc, char** argv) {
+
+    // options
+    int maxsolutions = MAX_SOLUTIONS;     // zero for no limit
+    OutputFormat format = FORMAT_HUMAN;
+    FILE* solutions = stdout;
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-t") == 0 && arg+1 < argc) {
+            // time limit in seconds for each solver
+            gLimits.seconds = atof(argv[++arg]);
+        }
+        else if (strcmp(argv[arg], "-w") == 0 && arg+1 < argc && atoi(argv[arg+1]) >= 2 && atoi(argv[arg+1]) <= 31) {
+            // size of numbers in bits
+            gNumberWidth = atoi(argv[++arg]);
+        }
+        else if (strcmp(argv[arg], "-n") == 0 && arg+1 < argc && atoi(argv[arg+1]) >= 0) {
+            // max number of solutions printed per expression; 0 for all
+            maxsolutions = atoi(argv[++arg]);
+        }
+        else if (strcmp(argv[arg], "-f") == 0 && arg+1 < argc && parseOutputFormat(argv[arg+1]) >= 0) {
+            // format of the solutions
+            format = parseOutputFormat(argv[++arg]);
+        }
+        else if (strcmp(argv[arg], "-o") == 0 && arg+1 < argc) {
+            // solutions to a file instead of stdout
+            char* solutionfilename = argv[++arg];
+            solutions = fopen(solutionfilename, "wb");
+            if (solutions == NULL) {
+                printf("failed to open file %s\n", solutionfilename);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[arg], "-p") == 0) {
+            // profile of each expression subtree
+            gProfiling = TRUE;
+        }
+        else if (strcmp(argv[arg], "-T") == 0 && arg+1 < argc) {
+            // trace of the time spent, in Chrome trace event format
+            char* tracefilename = argv[++arg];
+            if (!openTrace(tracefilename)) {
+                printf("failed to open file %s\n", tracefilename);
+                return 1;
+            }
+        }
+        else {
+            printf("usage: %s [-t seconds] [-w bits] [-n maxsolutions] [-f human|delta|csv|jsonl|binary] "
+                   "[-o solutionfile] [-p] [-T tracefile] [inputfile]\n", argv[0]);
+            return 1;
+        }
+        arg++;
+    }
+
+    // open input; defaults to stdin
+    FILE* input = stdin;
+    if (arg < argc) {
+        char* inputfilename = argv[arg];
+        input = fopen(inputfilename, "rt");
+        if (input == NULL) { 
+            printf("failed to open file %s\n",inputfilename);
+            return 1;
+        }
+    }
+
+    Lexer* lexer = newLexer(input);
+
+    // solutions are written through one large buffer; output to a terminal stays line by line
+    if (!isatty(fileno(stdout))) setvbuf(stdout, NULL, _IOFBF, WRITER_BUFFER);
+    Writer* writer = newWriter(solutions, WRITER_BUFFER);
+
+    while (!lexer->eof) { 
+    
+        ALLOC_PHASE("parse")
+        startProfile();
+        gLimitReached = FALSE;
+        Problem* problem = newProblem();
+        
+        // parse expression
+        double parsestart = traceStart();
+        Expr* expr = parseExpr(lexer);
+        traceSpan("parse", parsestart, NULL);
+        double start = traceStart();
+        if (expr == NULL) {
+            printf("End of Input.\n");
+            deleteProblem(problem);
+            deleteExprs();
+            continue;
+        }
+    
+        // if expr is numerical, impicityly prepend CON=?1
+        // else if expr is boolean, impicityly prepend CON
+            switch (expr->op) {
+                case VAR: 
+                case PNTR: 
+                case NUM:
+                case EVAL:
+                case MIN: 
+                case MAX: 
+                case COUNT: 
+                case NEG:
+                case ADD:
+                case SUB:
+                case MUL:
+                case DIV:
+                case MOD:
+                case SHL:
+                    expr = newExpr(CON, "@", newExpr(EQ, "=", newExpr(VAR,"?1",NULL,NULL),expr),NULL);        
+                    break;
+
+                case NOT:
+                case IND:
+                case EQ:
+                case IMPL:
+                case AND:
+                case OR:
+                case XOR:
+                case LT:
+                case GT:
+                    expr = newExpr(CON, "@",expr,NULL);        
+                    break;
+                
+                case CON:
+                    break;
+        }   
+
+        // rewrite with identities that shrink the circuits
+        double rewritestart = traceStart();
+        int eliminated = 0;
+        expr = rewriteExpr(expr, &eliminated);
+        traceSpan("rewrite", rewritestart, NULL);
+
+        // inform user of interpretation
+        printExpr(expr,1);
+        if (eliminated > 0) printf("rewrite: %d nodes eliminated\n", eliminated);
+     
+         // create boolean problem
+        ALLOC_PHASE("encode")
+        double convertstart = traceStart();
+        List* literals = convertExpr(expr, problem);
+        traceSpan("convert", convertstart, NULL);
+        if (literals == NULL) {
+            deleteProblem(problem);
+            deleteExprs();
+            if (gLimitReached) printf("Incomplete: resource limit reached in a subproblem\n");
+            else printf("Error: Invalid expression\n");
+            continue;
+        }
+     
+        // ---- simplify problem
+        ALLOC_PHASE("simplify")
+         
+        // mark time
+        struct timeval tv0;
+        gettimeofday(&tv0,NULL);
+
+       
+        // add a rule to ensure all variables are included
+        addRule2(problem, 0,0, problem->maxlit, 0);
+
+        // simplify and substitute old problem
+        // note: litrerals is changed in place!
+        double simplifystart = traceStart();
+        Problem* newProblem = Simplify(problem, literals);
+        traceSpan("simplify", simplifystart, NULL);
+        deleteProblem(problem);
+        problem = newProblem;
+            
+        // ------- solve problem  -----
+        ALLOC_PHASE("solve")
+ 
+        // mark time
+        struct timeval tv1;
+        gettimeofday(&tv1,NULL);
+
+       
+        // add a rule to ensure all variables are include
+        addRule2(problem, 0,0, problem->maxlit, 0);
+
+        // problem rules as solver input
+        double solvestart = traceStart();
+        int* rules = BufferArray(problem->rules);
+        // create solver
+        Solver* solver = newSolver(rules, NULL);
+        if (gProfiling) EnableRuleStatistics(solver);
+
+        // solutions are distinct values of the variables
+        List* varliterals = NewList();
+        int var;
+        int bit;
+        for (var=0;var<problem->symbols.count;var++) {
+            for (bit=0;bit<gNumberWidth;bit++) {
+                ListAppend(varliterals, problem->symbols.symbols[var].firstlit + bit);
+            }
+        }
+        setProjection(solver, varliterals);
+        DeleteList(varliterals);
+
+        // print some statistics
+        printf("Solving...\n");
+        printf("%d variables\n", solver->gNumberOfVariables);
+        printf("%d rules\n", solver->gNumberOfRules);
+        
+        // print solutions, with the variables in output order
+        OutputPlan* plan = newOutputPlan(problem, format);
+        writeHeader(writer, plan);
+        int numSol = 0;
+        while (nextSolution(solver)) {
+            ALLOC_PHASE("output")
+            ++numSol;
+            if (maxsolutions > 0 && numSol > maxsolutions) {
+                printf("WARNING: Problem has more than %d solutions. Result truncated.\n", maxsolutions);
+                break;
+            }
+            // print all variables
+            writeSolution(writer, plan, solver, numSol);
+            // solutions on stdout are kept in order with the other messages
+            if (solutions == stdout || writer->count >= WRITER_BUFFER/2) flushWriter(writer);
+            /*
+            // answer to expresion
+            int* array = List2Array(literals);
+            if (array != NULL) { 
+                int num = GetSignedNumber(solver, array);
+                printf(" %s=%d\n", "ans", num);
+                free(array);
+            }
+            */
+            ALLOC_PHASE("solve")
+        }
+        traceSpan("solve", solvestart, solver);
+        flushWriter(writer);
+        deleteOutputPlan(plan);
+
+        // mark time
+        struct timeval tv2;
+        gettimeofday(&tv2,NULL);
+
+        // compute time in seconds
+        double t0 = (double)tv0.tv_sec + ((double)tv0.tv_usec) * 1e-6;
+        double t1 = (double)tv1.tv_sec + ((double)tv1.tv_usec) * 1e-6;
+        double t2 = (double)tv2.tv_sec + ((double)tv2.tv_usec) * 1e-6;
+
+        // more statistics
+        ALLOC_PHASE("output")
+        if (solver->gLastResult == LIMIT_REACHED) printf("Incomplete: resource limit reached after %d solutions\n", numSol);
+        else printf("%d solutions\n",numSol);
+        printf("%d propagations\n", solver->gNumProp);
+        printf("%d choices\n", solver->gNumChoice);
+        WritePerfCounters(solver, stdout);
+        printf("simplify %f seconds\n", t1-t0);
+        printf("solve %f seconds\n", t2-t1);
+        printf("total %f seconds\n", t2-t0);
+        if (gProfiling) printProfile(problem, solver);
+   
+        // clean up
+        DeleteSolver(solver);
+        DeleteList(literals); 
+        deleteProblem(problem);
+        deleteExprs();
+        traceSpan("expression", start, NULL);
+    }   // while !eof
+    deleteWriter(writer);
+    deleteLexer(lexer);
+    if (input != stdin) fclose(input);
+    if (solutions != stdout) fclose(solutions);
+    closeTrace();
+    ALLOC_REPORT(stderr)
+    return 0;
+} // main
+
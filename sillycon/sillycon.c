@@ -22,44 +22,164 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
 
 #include "bps.h"
+#include "sillycon.h"
 
-#define MAX_WORD_LENGTH     255     // buffer for parsing terms 
-#define MAX_VARS    1000            // memory allocated for varibales
-#define NUMBER_WIDTH    9           // size of numbers in bits
-#define MAX_SOLUTIONS   100         // max number of solutions printed
+// resource limits for each solver (main problem and subproblems), set on the command line
+Limits gLimits;
+
+// size of numbers in bits, set on the command line
+int gNumberWidth = NUMBER_WIDTH;
+
+// print progress and statistics of subproblems and Simplify
+int gVerbose = TRUE;
+
+// record a profile of the conversion of expressions, see convertExpr
+int gProfiling = FALSE;
+ProfileEntry* gProfile = NULL;
+int gProfileSize = 0;
+int gProfileCapacity = 0;
+// entry of the expression node being converted; its tag for new rules
+int gProfileCurrent = -1;
 
 typedef enum {NONE=0,ALPHA,DIGIT,SPACE,PUNCT,OTHER}  Kind;
 
+// ---------------- input -------------
+
+#define LEXER_BUFFER    65536       // size of the buffer for input read as it arrives
+
+Lexer* newLexer(FILE* file) {
+    Lexer* lexer = (Lexer*)calloc(1, sizeof(Lexer));
+    lexer->fd = fileno(file);
+    lexer->line = 1;
+    lexer->column = 1;
+    struct stat st;
+    if (lexer->fd >= 0 && fstat(lexer->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // all input at once
+        lexer->length = st.st_size;
+        lexer->buffer = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, lexer->fd, 0);
+        if (lexer->buffer != MAP_FAILED) {
+            lexer->mapped = TRUE;
+        } else {
+            lexer->buffer = (char*)malloc(st.st_size);
+            lexer->owned = TRUE;
+            lexer->length = fread(lexer->buffer, 1, st.st_size, file);
+        }
+        lexer->fd = -1;
+    } else {
+        lexer->buffer = (char*)malloc(LEXER_BUFFER);
+        lexer->owned = TRUE;
+    }
+    return lexer;
+}
+
+Lexer* newStringLexer(char* string, long length) {
+    Lexer* lexer = (Lexer*)calloc(1, sizeof(Lexer));
+    lexer->fd = -1;
+    lexer->buffer = string;
+    lexer->length = length;
+    lexer->line = 1;
+    lexer->column = 1;
+    return lexer;
+}
+
+void deleteLexer(Lexer* lexer) {
+    if (lexer == NULL) return;
+    if (lexer->mapped) munmap(lexer->buffer, lexer->length);
+    if (lexer->owned) free(lexer->buffer);
+    free(lexer);
+}
+
+// the next character, or EOF
+int peekChar(Lexer* lexer) {
+    if (lexer->pos == lexer->length) {
+        if (lexer->fd < 0 || lexer->eof) {
+            lexer->eof = TRUE;
+            return EOF;
+        }
+        // read what has arrived (a line from a terminal)
+        long count = read(lexer->fd, lexer->buffer, LEXER_BUFFER);
+        if (count <= 0) {
+            lexer->eof = TRUE;
+            return EOF;
+        }
+        lexer->length = count;
+        lexer->pos = 0;
+    }
+    return (unsigned char)lexer->buffer[lexer->pos];
+}
+
+// moves past the character returned by peekChar
+void nextChar(Lexer* lexer) {
+    if (lexer->buffer[lexer->pos++] == '\n') {
+        lexer->line++;
+        lexer->column = 1;
+    }
+    else lexer->column++;
+}
+
 /* parse a terminal from input, return it's kind and fill a string with the terminal's chars */ 
 /* A terminal is a string that is either: 
         a string alhabetic chars
+        a variable name in brackets, e.g. [total] (kind ALPHA, without the brackets)
         a string of digits
         a punctuation character
    Never creates a string with whitespace or other characters
+   Comments are enclosed in double quotes
    Number of characters in string <= MAX_WORD_LENGTH
    Returns the kind of the term
    Note that term will be appended with a 0, so must be allocated for MAX_WORD_LENGTH+1
 */
-Kind parseTerm(FILE* input, char* term) {
+Kind parseTerm(Lexer* input, char* term) {
     int count = 0;
     int c;
     Kind lastkind = NONE;
     Kind kind = NONE;
-    while ((c = fgetc(input)) != 0 && count < MAX_WORD_LENGTH && !feof(input)) {
+    while (count < MAX_WORD_LENGTH && (c = peekChar(input)) != EOF) {
+        if (c == 0) {
+            // end of string
+            nextChar(input);
+            break;
+        }
         if (c == '"') { 
             // comment
-            while (!feof(input) && fgetc(input) != '"') {}; 
+            nextChar(input);
+            while ((c = peekChar(input)) != EOF) {
+                nextChar(input);
+                if (c == '"') break;
+            }
             continue;
         }
+        if (lastkind == NONE) {
+            input->tokenline = input->line;
+            input->tokencolumn = input->column;
+        }
+        if (c == '[' && lastkind == NONE) {
+            // long variable name
+            nextChar(input);
+            while ((c = peekChar(input)) != EOF && count < MAX_WORD_LENGTH) {
+                nextChar(input);
+                if (c == ']') break;
+                term[count++] = c;
+            }
+            lastkind = ALPHA;
+            break;
+        }
         else if (isalpha(c)) kind = ALPHA;
         else if (isdigit(c)) kind = DIGIT;
         else if (isspace(c)) kind = SPACE;
         else if (ispunct(c)) kind = PUNCT;
         else kind=OTHER;
         if (lastkind == NONE) {
+            nextChar(input);
             if (kind == PUNCT) {
                 term[count++] = c;
                 lastkind = kind;
@@ -77,12 +197,12 @@ Kind parseTerm(FILE* input, char* term) {
             }
         }
         else if (kind == lastkind) { 
+            nextChar(input);
             term[count++] = c;
             lastkind = kind;
         }
         else 
         {
-            ungetc(c, input);
             break;
         }
     }
@@ -91,75 +211,168 @@ Kind parseTerm(FILE* input, char* term) {
 }
 
 //  ----------- Expression tree ----------
+// Expressions and their terms are allocated in an arena, and released all
+// at once by deleteExprs, after each top-level expression.
+// Equal subexpressions are shared (see newExpr), and converted once per problem
+// (see convertExpr).
 
-typedef enum {VAR,NUM,                   // terminals
-    NOT,NEG,                             // unary operators
-    EQ,AND,OR,XOR,IMPL,                    // binary operators (logic) 
-    ADD,SUB,MUL,DIV,MOD,                 // binary operators (artihmetic)
-    LT,GT,                               // binary operators (comparisons)
-    EVAL,MIN,MAX,IND,                    // special solvers (binary)
-    COUNT,                               // counting solver (unary)
-    CON,                                 // constrain equal 1 (unuary)
-    PNTR                                  // a pointer to a variable 
-} Operator;
+#define ARENA_BLOCK     65536       // size of the blocks of the arena
 
 typedef struct {
-    Operator op;
-    char* term;
-    void* left;
-    void* right;
-} Expr;
+    void* prev;             // previous block
+    long size;
+    long used;
+    char data[];
+} ArenaBlock;
+
+ArenaBlock* gExprArena = NULL;
+
+void* arenaAlloc(long size) {
+    // keep pointers aligned
+    size = (size + sizeof(void*) - 1) & ~(long)(sizeof(void*) - 1);
+    ArenaBlock* block = gExprArena;
+    if (block == NULL || block->used + size > block->size) {
+        long blocksize = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+        block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + blocksize);
+        block->prev = gExprArena;
+        block->size = blocksize;
+        block->used = 0;
+        gExprArena = block;
+    }
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+// The expressions made since deleteExprs, hashed on operator, term and children,
+// so an equal expression is made once (the expression trees are DAGs). 
+// The children of commutative operators are hashed in any order.
+Expr** gExprTable = NULL;
+int gExprTableSize = 0;         // a power of two, at least twice the count
+int gExprTableCount = 0;
+
+// releases all expressions; the first block is kept for the next expression
+void deleteExprs() {
+    while (gExprArena != NULL && gExprArena->prev != NULL) {
+        ArenaBlock* prev = (ArenaBlock*)gExprArena->prev;
+        free(gExprArena);
+        gExprArena = prev;
+    }
+    if (gExprArena != NULL) gExprArena->used = 0;
+    if (gExprTable != NULL) memset(gExprTable, 0, gExprTableSize*sizeof(Expr*));
+    gExprTableCount = 0;
+}
+
+int isCommutative(Operator op) {
+    return op == ADD || op == MUL || op == AND || op == OR || op == XOR || op == EQ;
+}
+
+unsigned int hashExpr(Operator op, char* term, Expr* left, Expr* right) {
+    unsigned int h = 2166136261u ^ (unsigned int)op;
+    while (*term) {
+        h = (h ^ (unsigned char)*term++) * 16777619u;
+    }
+    size_t a = (size_t)left;
+    size_t b = (size_t)right;
+    if (isCommutative(op) && a > b) {
+        size_t t = a; a = b; b = t;
+    }
+    h = (h ^ (unsigned int)(a >> 3)) * 2654435761u;
+    h = (h ^ (unsigned int)(b >> 3)) * 2246822519u;
+    return h ^ (h >> 15);
+}
+
+// the slot of the expression in the table: the expression, or the empty slot to insert it
+int findExpr(Operator op, char* term, Expr* left, Expr* right) {
+    int slot = hashExpr(op, term, left, right) & (gExprTableSize-1);
+    Expr* expr;
+    while ((expr = gExprTable[slot]) != NULL) {
+        if (expr->op == op && strcmp(expr->term, term) == 0 
+            && ((expr->left == left && expr->right == right)
+                || (isCommutative(op) && expr->left == right && expr->right == left))) break;
+        slot = (slot+1) & (gExprTableSize-1);
+    }
+    return slot;
+}
 
+// an equal expression is shared, except for EVAL and IND: each of those has its own solutions
 Expr* newExpr(Operator op, char* term, Expr* left, Expr* right) {
-        Expr* expr = malloc(sizeof(Expr));
-        expr->op = op;
-        expr->left = left;
-        expr->right = right;
-        int len = strlen(term)+1;
-        expr->term = malloc(len*sizeof(char));
-        strncpy(expr->term, term, len);
-        return expr;
+    int shared = op != EVAL && op != IND;
+    if (shared) {
+        if (2*(gExprTableCount+1) > gExprTableSize) {
+            // grow and rehash
+            Expr** old = gExprTable;
+            int oldsize = gExprTableSize;
+            gExprTableSize = oldsize > 0 ? 2*oldsize : 1024;
+            gExprTable = (Expr**)calloc(gExprTableSize, sizeof(Expr*));
+            int i;
+            for (i=0;i<oldsize;i++) {
+                Expr* e = old[i];
+                if (e != NULL) gExprTable[findExpr(e->op, e->term, e->left, e->right)] = e;
+            }
+            free(old);
+        }
+        Expr* expr = gExprTable[findExpr(op, term, left, right)];
+        if (expr != NULL) {
+            expr->refs++;
+            return expr;
+        }
+    }
+    Expr* expr = (Expr*)arenaAlloc(sizeof(Expr));
+    expr->op = op;
+    expr->left = left;
+    expr->right = right;
+    int len = strlen(term)+1;
+    expr->term = (char*)arenaAlloc(len);
+    memcpy(expr->term, term, len);
+    expr->refs = 1;
+    if (shared) {
+        gExprTable[findExpr(op, term, left, right)] = expr;
+        gExprTableCount++;
+    }
+    return expr;
 }
 
-Expr* parseExpr(FILE* input) {
+// the operators of the language
+typedef struct {
+    char symbol;
+    Operator op;
+    int arity;
+} OperatorSymbol;
+
+OperatorSymbol gOperatorSymbols[] = {
+    {'+', ADD, 2}, {'*', MUL, 2}, {'/', DIV, 2}, {'%', MOD, 2},
+    {'&', AND, 2}, {'|', OR, 2}, {'^', XOR, 2}, {'=', EQ, 2}, {':', IMPL, 2},
+    {'>', GT, 2}, {'<', LT, 2},
+    {'!', NOT, 1}, {'-', NEG, 1}, {'@', CON, 1}, {'#', COUNT, 1},
+    {'$', MAX, 2}, {'_', MIN, 2}, {'\'', EVAL, 2}, {'`', IND, 2},
+    {'?', PNTR, 1},
+    {0, VAR, 0}
+};
+
+Expr* parseExpr(Lexer* input) {
     char term[MAX_WORD_LENGTH+1];
     Kind kind = parseTerm(input, term);
     Expr* expr = NULL;
     if (kind == PUNCT) {
-        Operator op;
-        if (strcmp(term,"+")==0) op = ADD; 
-        else if (strcmp(term,"*")==0) op = MUL; 
-        else if (strcmp(term,"/")==0) op = DIV; 
-        else if (strcmp(term,"%")==0) op = MOD; 
-        else if (strcmp(term,"&")==0) op = AND; 
-        else if (strcmp(term,"|")==0) op = OR;
-        else if (strcmp(term,"^")==0) op = XOR;
-        else if (strcmp(term,"=")==0) op = EQ;
-        else if (strcmp(term,":")==0) op = IMPL;
-        else if (strcmp(term,">")==0) op = GT;
-        else if (strcmp(term,"<")==0) op = LT;
-        else if (strcmp(term,"!")==0) op = NOT;
-        // else if (strcmp(term,"-")==0) op = SUB; 
-        else if (strcmp(term,"-")==0) op = NEG;
-        else if (strcmp(term,"@")==0) op = CON;
-        else if (strcmp(term,"#")==0) op = COUNT;
-        else if (strcmp(term,"$")==0) op = MAX;
-        else if (strcmp(term,"_")==0) op = MIN;
-        else if (strcmp(term,"'")==0) op = EVAL;
-        else if (strcmp(term,"`")==0) op = IND;
-        else if (strcmp(term,"?")==0) op = PNTR;
-        else {
-            printf("Unknown operator: %s\n",term);
+        OperatorSymbol* symbol = gOperatorSymbols;
+        while (symbol->symbol != 0 && symbol->symbol != term[0]) symbol++;
+        if (symbol->symbol == 0) {
+            printf("Unknown operator: %s (line %d, column %d)\n",term, input->tokenline, input->tokencolumn);
         return NULL;
         }
+        Operator op = symbol->op;
+        // position of the operator, for errors
+        int line = input->tokenline;
+        int column = input->tokencolumn;
         // get left and right (for binary operators)
         Expr* left = NULL;
         Expr* right = NULL;
-        if (op == CON || op == NOT || op == COUNT || op == NEG || op == PNTR) {
+        if (symbol->arity == 1) {
             // unary operators
             left = parseExpr(input);
             if (left == NULL) { 
-                printf("Error: Incomplete input.\n");
+                printf("Error: Incomplete input for %s (line %d, column %d).\n", term, line, column);
                 return NULL;
             }
         } else {
@@ -167,11 +380,11 @@ Expr* parseExpr(FILE* input) {
             left = parseExpr(input);
             right = parseExpr(input);
             if (left == NULL) { 
-                printf("Error: Incomplete Input.\n");
+                printf("Error: Incomplete input for %s (line %d, column %d).\n", term, line, column);
                 return NULL;
             }
             if (right == NULL) { 
-                printf("Error: Incomplete Input.\n");
+                printf("Error: Incomplete input for %s (line %d, column %d).\n", term, line, column);
                 return NULL;
             }
         }
@@ -207,6 +420,57 @@ void printExpr(Expr* expr, int depth) {
 
 // --------------- misc ------
 
+// monotonic wall clock time in seconds
+double wallTime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec) * 1e-9;
+}
+
+// ---------------- trace -------------
+// Spans of time in Chrome trace event format (JSON), for viewing in a timeline
+// (chrome://tracing or Perfetto). Each span is written when it ends.
+
+FILE* gTraceFile = NULL;
+double gTraceStart;         // time of openTrace; timestamps are relative to it
+int gTraceEvents;
+
+// starts writing a trace to a new file; returns zero on failure
+int openTrace(char* filename) {
+    gTraceFile = fopen(filename, "wt");
+    if (gTraceFile == NULL) return 0;
+    gTraceStart = wallTime();
+    gTraceEvents = 0;
+    fprintf(gTraceFile, "{\"traceEvents\": [\n");
+    return 1;
+}
+
+void closeTrace() {
+    if (gTraceFile == NULL) return;
+    fprintf(gTraceFile, "\n]}\n");
+    fclose(gTraceFile);
+    gTraceFile = NULL;
+}
+
+// start time of a span
+double traceStart() {
+    return gTraceFile != NULL ? wallTime() : 0.0;
+}
+
+// writes a span from start until now, with the size and statistics of the solver, if any
+void traceSpan(const char* name, double start, Solver* solver) {
+    if (gTraceFile == NULL) return;
+    double now = wallTime();
+    fprintf(gTraceFile, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f",
+            gTraceEvents++ > 0 ? ",\n" : "", name, (start - gTraceStart) * 1e6, (now - start) * 1e6);
+    if (solver != NULL) {
+        fprintf(gTraceFile, ", \"args\": {\"variables\": %d, \"rules\": %d, \"propagations\": %d, \"choices\": %d}",
+                solver->gNumberOfVariables, solver->gNumberOfRules, solver->gNumProp, solver->gNumChoice);
+    }
+    fprintf(gTraceFile, "}");
+}
+
+
 List* copyList(List* list) {
     List* new = NewList();
     Node* node = list->first;
@@ -228,31 +492,501 @@ void printList(List* list) {
     printf("]\n");
 }
 
-int* List2Array(List* l) {
-    if (l==NULL) return NULL;
-    if (l->count < 1) return NULL;
-    int* a = malloc((l->count+2)*sizeof(int));
-    int i = 0;
-    Node* n = l->first;
-    while (n) {
-        a[i++] = n->value;
-        n = n->next;
+// ---------------- solver -------------
+
+// creates a solver with the resource limits given on the command line 
+Solver* newSolver(int* rules, List* ordered) {
+    Solver* solver = NewSolver2(rules, ordered);
+    SetLimits(solver, &gLimits, NULL);
+    return solver;
+}
+
+int gLimitReached = FALSE;
+
+// substitute bps.c's NextSolution; a search that reached a limit is reported and ends
+// (Solver.gLastResult is then LIMIT_REACHED, and gLimitReached is set)
+int nextSolution(Solver* solver) {
+    int result = NextSolution(solver);
+    if (result == LIMIT_REACHED) {
+        printf("\nWARNING: Resource limit reached. Search incomplete.\n");
+        gLimitReached = TRUE;
+        return 0;
+    }
+    if (result == SEARCH_FAILED) printf("\nError: optimization failed.\n");
+    return result == SOLUTION_FOUND;
+}
+
+// solutions only differ in the values of the given literals (see bps.h SetProjection)
+void setProjection(Solver* solver, List* literals) {
+    int* array = List2Array(literals);
+    if (array != NULL) {
+        SetProjection(solver, array);
+        free(array);
     }
-    a[i++] = 0;
-    a[i++] = 0;
-    return a;
 }
 
-// ---------------- problem -------------
+// finds the solution with the minimum (or maximum) signed value of the given literals
+// returns non-zero if found; the solver is then at that solution
+// a limit is reported as by nextSolution
+int optimize(Solver* solver, List* literals, int maximize) {
+    Objective objective;
+    objective.literals = List2Array(literals);
+    if (objective.literals == NULL) return nextSolution(solver);
+    objective.isSigned = TRUE;
+    objective.maximize = maximize;
+    int result = Optimize(solver, &objective, 1);
+    free(objective.literals);
+    if (result == LIMIT_REACHED) {
+        printf("\nWARNING: Resource limit reached. Search incomplete.\n");
+        solver->gLastResult = LIMIT_REACHED;
+        gLimitReached = TRUE;
+        return 0;
+    }
+    if (result == SEARCH_FAILED) printf("\nError: optimization failed.\n");
+    return result == SOLUTION_FOUND;
+}
+
+// ---------------- symbol table -------------
+
+void initSymbols(SymbolTable* table) {
+    table->count = 0;
+    table->capacity = 16;
+    table->symbols = (Symbol*)malloc(table->capacity*sizeof(Symbol));
+    table->hashsize = 2*table->capacity;
+    table->hash = (int*)calloc(table->hashsize, sizeof(int));
+}
+
+void deleteSymbols(SymbolTable* table) {
+    int i;
+    for (i=0;i<table->count;i++) {
+        free(table->symbols[i].name);
+    }
+    free(table->symbols);
+    free(table->hash);
+}
+
+// FNV-1a
+unsigned int hashName(char* name) {
+    unsigned int h = 2166136261u;
+    while (*name) {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+    return h;
+}
+
+// a copy of the name; not strdup, so the allocation profile counts it (alloc_profile.h)
+char* copyName(char* name) {
+    int len = strlen(name)+1;
+    char* copy = (char*)malloc(len);
+    memcpy(copy, name, len);
+    return copy;
+}
+
+// the slot in the hash index of the name: its symbol, or the empty slot to insert it
+int findSlot(SymbolTable* table, char* name) {
+    int slot = hashName(name) & (table->hashsize-1);
+    while (table->hash[slot] != 0 && strcmp(table->symbols[table->hash[slot]-1].name, name) != 0) {
+        slot = (slot+1) & (table->hashsize-1);
+    }
+    return slot;
+}
+
+Symbol* findSymbol(Problem* p, char* name) {
+    int index = p->symbols.hash[findSlot(&p->symbols, name)];
+    return index != 0 ? &p->symbols.symbols[index-1] : NULL;
+}
+
+Symbol* addSymbol(Problem* p, char* name, int firstlit) {
+    SymbolTable* table = &p->symbols;
+    if (table->count == table->capacity) {
+        // double the capacity and rebuild the hash index
+        table->capacity *= 2;
+        table->symbols = (Symbol*)realloc(table->symbols, table->capacity*sizeof(Symbol));
+        free(table->hash);
+        table->hashsize = 2*table->capacity;
+        table->hash = (int*)calloc(table->hashsize, sizeof(int));
+        int i;
+        for (i=0;i<table->count;i++) {
+            table->hash[findSlot(table, table->symbols[i].name)] = i+1;
+        }
+    }
+    Symbol* symbol = &table->symbols[table->count++];
+    symbol->name = copyName(name);
+    symbol->firstlit = firstlit;
+    table->hash[findSlot(table, name)] = table->count;
+    return symbol;
+}
+
+void copySymbols(SymbolTable* to, SymbolTable* from) {
+    deleteSymbols(to);
+    *to = *from;
+    to->symbols = (Symbol*)malloc(to->capacity*sizeof(Symbol));
+    to->hash = (int*)malloc(to->hashsize*sizeof(int));
+    memcpy(to->hash, from->hash, to->hashsize*sizeof(int));
+    int i;
+    for (i=0;i<to->count;i++) {
+        to->symbols[i].name = copyName(from->symbols[i].name);
+        to->symbols[i].firstlit = from->symbols[i].firstlit;
+    }
+}
+
+// output order: letters and numbered variables by number, then long names in order of definition
+long symbolOrder(SymbolTable* table, int index) {
+    char* name = table->symbols[index].name;
+    if (name[0] == '?') return atol(name+1);
+    if (name[1] == 0) return (unsigned char)name[0];
+    return (long)INT_MAX + 1 + index;
+}
+
+SymbolTable* gSortTable;        // the table sorted by sortedSymbols
+
+int compareSymbols(const void* a, const void* b) {
+    long oa = symbolOrder(gSortTable, *(const int*)a);
+    long ob = symbolOrder(gSortTable, *(const int*)b);
+    return (oa > ob) - (oa < ob);
+}
+
+int* sortedSymbols(Problem* p) {
+    int* order = (int*)malloc((p->symbols.count+1)*sizeof(int));
+    int i;
+    for (i=0;i<p->symbols.count;i++) {
+        order[i] = i;
+    }
+    gSortTable = &p->symbols;
+    qsort(order, p->symbols.count, sizeof(int), compareSymbols);
+    return order;
+}
+
+// ---------------- gates -------------
+
+void initGates(GateTable* table) {
+    table->count = 0;
+    table->size = 256;
+    table->gates = (Gate*)calloc(table->size, sizeof(Gate));
+}
+
+void deleteGates(GateTable* table) {
+    free(table->gates);
+}
+
+void copyGates(GateTable* to, GateTable* from) {
+    deleteGates(to);
+    *to = *from;
+    to->gates = (Gate*)malloc(to->size*sizeof(Gate));
+    memcpy(to->gates, from->gates, to->size*sizeof(Gate));
+}
 
+unsigned int hashGate(int kind, int left, int right) {
+    unsigned int h = (unsigned int)kind * 2654435761u;
+    h = (h ^ (unsigned int)left) * 2246822519u;
+    h = (h ^ (unsigned int)right) * 3266489917u;
+    return h ^ (h >> 15);
+}
+
+// the slot of the gate: the gate, or the empty slot to insert it
+Gate* findGate(GateTable* table, int kind, int left, int right) {
+    int slot = hashGate(kind, left, right) & (table->size-1);
+    Gate* gate = &table->gates[slot];
+    while (gate->kind != 0 && (gate->kind != kind || gate->left != left || gate->right != right)) {
+        slot = (slot+1) & (table->size-1);
+        gate = &table->gates[slot];
+    }
+    return gate;
+}
+
+void addGate(GateTable* table, int kind, int left, int right, int out) {
+    if (2*(table->count+1) > table->size) {
+        // grow and rehash
+        Gate* old = table->gates;
+        int oldsize = table->size;
+        table->size *= 2;
+        table->gates = (Gate*)calloc(table->size, sizeof(Gate));
+        int i;
+        for (i=0;i<oldsize;i++) {
+            if (old[i].kind != 0) *findGate(table, old[i].kind, old[i].left, old[i].right) = old[i];
+        }
+        free(old);
+    }
+    Gate* gate = findGate(table, kind, left, right);
+    gate->kind = kind;
+    gate->left = left;
+    gate->right = right;
+    gate->out = out;
+    table->count++;
+}
+
+// ---------------- conversions -------------
+// the literals of the shared expressions converted in a problem
+
+void initConversions(ConversionTable* table) {
+    table->count = 0;
+    table->size = 0;
+    table->entries = NULL;
+}
+
+void deleteConversions(ConversionTable* table) {
+    int i;
+    for (i=0;i<table->size;i++) {
+        if (table->entries[i].expr != NULL) DeleteList(table->entries[i].literals);
+    }
+    free(table->entries);
+}
+
+// the slot of the expression: its conversion, or the empty slot to insert it
+Conversion* findConversion(ConversionTable* table, Expr* expr) {
+    int slot = (((unsigned int)((size_t)expr >> 3)) * 2654435761u) & (table->size-1);
+    while (table->entries[slot].expr != NULL && table->entries[slot].expr != expr) {
+        slot = (slot+1) & (table->size-1);
+    }
+    return &table->entries[slot];
+}
+
+// returns the literals of the expression, or NULL if not converted
+List* getConversion(ConversionTable* table, Expr* expr) {
+    if (table->count == 0) return NULL;
+    Conversion* conversion = findConversion(table, expr);
+    return conversion->expr != NULL ? conversion->literals : NULL;
+}
+
+// keeps a copy of the literals
+void addConversion(ConversionTable* table, Expr* expr, List* literals) {
+    if (2*(table->count+1) > table->size) {
+        // grow and rehash
+        Conversion* old = table->entries;
+        int oldsize = table->size;
+        table->size = oldsize > 0 ? 2*oldsize : 64;
+        table->entries = (Conversion*)calloc(table->size, sizeof(Conversion));
+        int i;
+        for (i=0;i<oldsize;i++) {
+            if (old[i].expr != NULL) *findConversion(table, old[i].expr) = old[i];
+        }
+        free(old);
+    }
+    Conversion* conversion = findConversion(table, expr);
+    conversion->expr = expr;
+    conversion->literals = copyList(literals);
+    table->count++;
+}
+
+// ---------------- rewrite -------------
+// Rewrites an expression with identities that shrink the circuits, before conversion:
+//  !!x -> x, --x -> x, &xx -> x, |xx -> x, duplicates in chains of & removed, 
+//  =xx -> 1, ^xx -> 0, <cx -> >xc and >cx -> <xc for a constant c, 
+//  constants folded, +x0 -> x, *x1 -> x, *x0 -> 0 and *x2^k -> x shifted left k bits.
+// The numbers of the encoders grow as needed, so these are exact, but NOT, NEG, MUL, DIV,
+// MOD, LT and GT depend on the number of bits of their operands (e.g. --256 is -256 in
+// 9 bits), so in their operands, and the operands of those, only the rewrites that keep 
+// the number of bits are done.
+// A subexpression is only removed if it adds no constraints, and every variable in it
+// occurs elsewhere in the expression, so the solutions are the same.
+
+#define MAX_FOLDED      (1<<14)     // constants are folded if the operands are smaller
+#define MAX_CHAIN       256         // max operands of a chain of & without duplicates
 
 typedef struct {
-    int maxlit;         // highest used literal
-    List* rules;        // all the rules in the form of a list of literals with zeros to terminate clauses 
-    int* var2lit;       // maps variable to first literal 
-    int true;           // literal that is true (always in the solution)
-    int false;          // literal that is false (never in the solution)
-} Problem;
+    Expr* var;              // the (shared) VAR expression
+    int count;              // occurrences
+} VarCount;
+
+VarCount* gVarCounts = NULL;
+int gVarCountSize = 0;      // a power of two
+
+VarCount* findVarCount(Expr* var) {
+    int slot = (((unsigned int)((size_t)var >> 3)) * 2654435761u) & (gVarCountSize-1);
+    while (gVarCounts[slot].var != NULL && gVarCounts[slot].var != var) {
+        slot = (slot+1) & (gVarCountSize-1);
+    }
+    return &gVarCounts[slot];
+}
+
+// the subsolvers and PNTR have variables in another context
+int isOpaque(Operator op) {
+    return op == EVAL || op == IND || op == MIN || op == MAX || op == COUNT || op == PNTR;
+}
+
+// adds delta to the counts of the variables in the expression
+void countVars(Expr* expr, int delta) {
+    if (expr == NULL || isOpaque(expr->op)) return;
+    if (expr->op == VAR) {
+        VarCount* entry = findVarCount(expr);
+        entry->var = expr;
+        entry->count += delta;
+        return;
+    }
+    countVars(expr->left, delta);
+    countVars(expr->right, delta);
+}
+
+int varsRemain(Expr* expr) {
+    if (expr == NULL || isOpaque(expr->op)) return 1;
+    if (expr->op == VAR) return findVarCount(expr)->count > 0;
+    return varsRemain(expr->left) && varsRemain(expr->right);
+}
+
+// no constraints, subproblems or pointers
+int isPure(Expr* expr) {
+    if (expr == NULL) return 1;
+    switch (expr->op) {
+        case CON: case DIV: case MOD: case SUB:
+        case EVAL: case IND: case MIN: case MAX: case COUNT: case PNTR:
+            return 0;
+        default:
+            return isPure(expr->left) && isPure(expr->right);
+    }
+}
+
+// removes the occurrences of the variables in the expression, if it can be removed
+int removeExpr(Expr* expr, int occurrences) {
+    if (!isPure(expr)) return 0;
+    countVars(expr, -occurrences);
+    if (varsRemain(expr)) return 1;
+    countVars(expr, +occurrences);
+    return 0;
+}
+
+long countNodes(Expr* expr) {
+    if (expr == NULL) return 0;
+    return 1 + countNodes(expr->left) + countNodes(expr->right);
+}
+
+Expr* makeConstant(long value) {
+    char term[24];
+    snprintf(term, 24, "%ld", value);
+    return newExpr(NUM, term, NULL, NULL);
+}
+
+int isConstant(Expr* expr, long value) {
+    return expr->op == NUM && atol(expr->term) == value;
+}
+
+// appends the operands of a chain of &; returns the count, or -1 if there are more than MAX_CHAIN
+int chainOperands(Expr* expr, Expr** operands, int count) {
+    if (count < 0) return count;
+    if (expr->op == AND) {
+        count = chainOperands(expr->left, operands, count);
+        return chainOperands(expr->right, operands, count);
+    }
+    if (count == MAX_CHAIN) return -1;
+    operands[count] = expr;
+    return count+1;
+}
+
+// exact: the number of bits of the value must be kept
+Expr* rewriteNode(Expr* expr, int exact) {
+    if (expr == NULL || expr->left == NULL || isOpaque(expr->op)) return expr;
+    Operator op = expr->op;
+    // the number of bits of the other results depends on the operands; = and @ are two bits
+    int exactoperands = op == NOT || op == NEG || op == MUL || op == DIV || op == MOD
+        || op == LT || op == GT || op == SUB || op == SHL || (exact && op != EQ && op != CON);
+    Expr* left = rewriteNode(expr->left, exactoperands);
+    Expr* right = rewriteNode(expr->right, exactoperands);
+    int constants = right != NULL && left->op == NUM && right->op == NUM
+        && atol(left->term) < MAX_FOLDED && atol(right->term) < MAX_FOLDED;
+
+    switch (op) {
+        case NOT: 
+        case NEG:
+            // the encoders invert and negate in the same number of bits
+            if (left->op == op) return left->left;
+            break;
+        case AND: {
+            // bitwise and is idempotent: the chain without duplicates
+            // (a chain of more than MAX_CHAIN operands is kept as it is)
+            Expr* operands[MAX_CHAIN];
+            int count = chainOperands(left, operands, 0);
+            count = chainOperands(right, operands, count);
+            if (count < 0) break;
+            int unique = 0;
+            int i, j;
+            for (i=0;i<count;i++) {
+                for (j=0;j<unique && operands[j] != operands[i];j++);
+                if (j < unique) countVars(operands[i], -1);
+                else operands[unique++] = operands[i];
+            }
+            if (unique == count) break;
+            Expr* chain = operands[0];
+            for (i=1;i<unique;i++) {
+                chain = newExpr(AND, expr->term, chain, operands[i]);
+            }
+            return chain;
+        }
+        case OR:
+            if (left == right) {
+                countVars(right, -1);
+                return left;
+            }
+            break;
+        case XOR:
+            if (left == right && !exact && removeExpr(left, 2)) return makeConstant(0);
+            break;
+        case EQ:
+            // the result of = is two bits, as the constants 0 and 1
+            if (constants) return makeConstant(atol(left->term) == atol(right->term));
+            if (left == right && removeExpr(left, 2)) return makeConstant(1);
+            break;
+        case LT:
+        case GT:
+            if (constants) return makeConstant(op == LT ? atol(left->term) < atol(right->term)
+                                                        : atol(left->term) > atol(right->term));
+            // the constant on the right; same encoding
+            if (left->op == NUM && right->op != NUM) return newExpr(op == LT ? GT : LT, op == LT ? ">" : "<", right, left);
+            break;
+        case ADD:
+            if (exact) break;
+            if (constants) return makeConstant(atol(left->term) + atol(right->term));
+            if (isConstant(right, 0)) return left;
+            if (isConstant(left, 0)) return right;
+            break;
+        case MUL: {
+            if (exact) break;
+            if (constants) return makeConstant(atol(left->term) * atol(right->term));
+            // the constant on the right
+            Expr* number = right;
+            Expr* other = left;
+            if (left->op == NUM) {
+                number = left;
+                other = right;
+            }
+            if (number->op != NUM) break;
+            long value = atol(number->term);
+            if (value == 1) return other;
+            if (value == 0) {
+                if (removeExpr(other, 1)) return number;
+                break;
+            }
+            // a power of two
+            if (value < MAX_FOLDED && (value & (value-1)) == 0) {
+                int shift = 0;
+                while (value > 1) {
+                    value >>= 1;
+                    shift++;
+                }
+                return newExpr(SHL, "<<", other, makeConstant(shift));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (left == expr->left && right == expr->right) return expr;
+    return newExpr(op, expr->term, left, right);
+}
+
+Expr* rewriteExpr(Expr* expr, int* eliminated) {
+    long nodes = countNodes(expr);
+    gVarCountSize = 64;
+    while (gVarCountSize < 2*nodes) gVarCountSize *= 2;
+    gVarCounts = (VarCount*)calloc(gVarCountSize, sizeof(VarCount));
+    countVars(expr, +1);
+    Expr* rewritten = rewriteNode(expr, FALSE);
+    free(gVarCounts);
+    gVarCounts = NULL;
+    *eliminated += nodes - countNodes(rewritten);
+    return rewritten;
+}
+
+// ---------------- problem -------------
+
 
 int newLit(Problem* p) {
     // new literal, increasing maxlit 
@@ -264,40 +998,47 @@ int newLit(Problem* p) {
     return lit; 
 }
 
+// counts a new rule, and tags it with the expression node being converted
+void tagRule(Problem* p, int tag) {
+    p->numrules++;
+    if (p->tags != NULL) BufferAppend(p->tags, tag);
+}
+
 void addRule(Problem* p, int* lhs, int* rhs) {
+    tagRule(p, gProfileCurrent);
     int lit;
     int i=0;
     while ((lit=lhs[i++])!=0) {
-        ListAppend(p->rules, lit);
+        BufferAppend(p->rules, lit);
     }
-    ListAppend(p->rules, 0);
+    BufferAppend(p->rules, 0);
     i=0;
     while ((lit=rhs[i++])!=0) {
-        ListAppend(p->rules, lit);
+        BufferAppend(p->rules, lit);
     }
-    ListAppend(p->rules, 0);
+    BufferAppend(p->rules, 0);
 }
 
 void addRule2(Problem* p, int l1, int l2, int r1, int r2) {
-    if (l1 != 0) ListAppend(p->rules, l1);
-    if (l2 != 0) ListAppend(p->rules, l2);
-    ListAppend(p->rules, 0);
-    if (r1 != 0) ListAppend(p->rules, r1);
-    if (r2 != 0) ListAppend(p->rules, r2);
-    ListAppend(p->rules, 0);
+    tagRule(p, gProfileCurrent);
+    if (l1 != 0) BufferAppend(p->rules, l1);
+    if (l2 != 0) BufferAppend(p->rules, l2);
+    BufferAppend(p->rules, 0);
+    if (r1 != 0) BufferAppend(p->rules, r1);
+    if (r2 != 0) BufferAppend(p->rules, r2);
+    BufferAppend(p->rules, 0);
 }
 
 Problem* newProblem () {
     // allocate
     Problem* p = (Problem*) malloc(sizeof(Problem));
     p->maxlit = 0;
-    p->rules = NewList(); 
-    p->var2lit = malloc(MAX_VARS*sizeof(int));
-    // clear mapping
-    int i;
-    for (i=0;i<MAX_VARS;i++) {     // unsi
-        p->var2lit[i] = 0;
-    }
+    p->rules = NewBuffer(1024);
+    p->numrules = 0;
+    p->tags = gProfiling ? NewBuffer(256) : NULL;
+    initSymbols(&p->symbols);
+    initGates(&p->gates);
+    initConversions(&p->conversions);
     // define true and false; only true can be in a solution
     int lit = newLit(p);
     int lhs[2] = {-lit, 0};
@@ -310,19 +1051,23 @@ Problem* newProblem () {
 
 void deleteProblem (Problem* p) {
     if (p == NULL) return; 
-    free(p->var2lit);
-    DeleteList(p->rules);
+    deleteSymbols(&p->symbols);
+    deleteGates(&p->gates);
+    deleteConversions(&p->conversions);
+    DeleteBuffer(p->rules);
+    DeleteBuffer(p->tags);
     free(p);
 }
 
 Problem* copyProblem (Problem* p) {
     Problem* new = newProblem();
-    DeleteList(new->rules);
-    new->rules = copyList(p->rules);
-    int i;
-    for (i=0;i<MAX_VARS;i++) {
-        new->var2lit[i] = p->var2lit[i];
-    } 
+    DeleteBuffer(new->rules);
+    new->rules = CopyBuffer(p->rules);
+    new->numrules = p->numrules;
+    DeleteBuffer(new->tags);
+    new->tags = p->tags != NULL ? CopyBuffer(p->tags) : NULL;
+    copySymbols(&new->symbols, &p->symbols);
+    copyGates(&new->gates, &p->gates);
     new->maxlit = p->maxlit;
     new->true = p->true;
     new->false = p->false;
@@ -344,89 +1089,65 @@ char* makeVarName(int var) {
     return name;
 }
 
-List* getVariable(Problem* p, char* name) {
+// a letter, a long name of letters, digits and underscores starting with a letter, or ?N
+int checkVarName(char* name) {
     if (strlen(name)==0) {
         printf("Error: empty variable name.\n");
-        return NULL;
+        return 0;
     } 
-    char c0= name[0];
-    int var;
-    if (isalpha(c0)) 
-        var = (int)c0;
-    else if (name[0] == '?')  
-        var = atoi(name+1);
-    else {
-        printf("Error: illegal variable name: %s.\n",name);
-        return NULL;
+    if (isalpha(name[0])) {
+        char* c;
+        for (c=name;*c;c++) {
+            if (!isalnum(*c) && *c != '_') {
+                printf("Error: illegal variable name: %s.\n",name);
+                return 0;
+            }
+        }
     }
-    if (var < 1) {
-        printf("Error: var < 1.\n");
-        return NULL;
+    else if (name[0] == '?') {
+        if (atol(name+1) < 1) {
+            printf("Error: var < 1.\n");
+            return 0;
+        }
     }
-    if (var >= MAX_VARS) {
-        printf("Error: var >= MAX_VAR.\n");
-        return NULL;
+    else {
+        printf("Error: illegal variable name: %s.\n",name);
+        return 0;
     }
+    return 1;
+}
 
-    // find in mapping
-    int firstlit = p->var2lit[var];
-    if (firstlit == 0) {
-        return NULL;
-    }
-    // return set of literals
+// the literals of a variable 
+List* symbolLiterals(Symbol* symbol) {
     List* literals = NewList();
     int lit;
-    for (lit=firstlit;lit<firstlit+NUMBER_WIDTH;lit++) {
+    for (lit=symbol->firstlit;lit<symbol->firstlit+gNumberWidth;lit++) {
         ListAppend(literals,lit);
     }
     return literals;
-    
+}
+
+List* getVariable(Problem* p, char* name) {
+    if (!checkVarName(name)) return NULL;
+    Symbol* symbol = findSymbol(p, name);
+    if (symbol == NULL) return NULL;
+    return symbolLiterals(symbol);
 }
 
 List* addOrGetVariable(Problem* p, char* name) {
-    if (strlen(name)==0) {
-        printf("Error: empty variable name.\n");
-        return NULL;
-    } 
-    char c0 = name[0]; 
-    int var;
-    if (isalpha(c0)) 
-        var = (int)c0;
-    else if (name[0] == '?')  
-        var = atoi(name+1);
-    else {
-        printf("Error: illegal variable name: %s.\n",name);
-        return NULL;
-    }
- 
-    if (var < 1) {
-        printf("Error: var < 1.\n");
-        return NULL;
-    }
-    if (var >= MAX_VARS) {
-        printf("Error: var >= MAX_VAR.\n");
-        return NULL;
-    }
+    if (!checkVarName(name)) return NULL;
     // find in mapping
-    int firstlit = p->var2lit[var];
-    if (firstlit == 0) {
+    Symbol* symbol = findSymbol(p, name);
+    if (symbol == NULL) {
         // .. or create new
-        firstlit = newLit(p); 
+        int firstlit = newLit(p); 
         int i;
-        for (i=1;i<NUMBER_WIDTH;i++) {
+        for (i=1;i<gNumberWidth;i++) {
             newLit(p);
         }
-        // store mapping
-        p->var2lit[var] = firstlit;
+        symbol = addSymbol(p, name, firstlit);
     }
-    // return set of literals
-    List* literals = NewList();
-    int lit;
-    for (lit=firstlit;lit<firstlit+NUMBER_WIDTH;lit++) {
-        ListAppend(literals,lit);
-    }
-    return literals;
- 
+    return symbolLiterals(symbol);
 }
 
 // ---------- constraints and expressions
@@ -467,7 +1188,16 @@ int literal2var(Problem* p, int literal) {
         return literal;
 }
 
+// the gates are hashed (see GateTable); constant and equal inputs are simplified
 int makeBoolAnd(Problem* p, int l, int r) {
+    if (l == p->false || r == p->false || l == -r) return p->false;
+    if (l == p->true || l == r) return r;
+    if (r == p->true) return l;
+    if (l > r) {
+        int t = l; l = r; r = t;
+    }
+    Gate* gate = findGate(&p->gates, GATE_AND, l, r);
+    if (gate->kind != 0) return gate->out;
     int and = newLit(p);
     addRule2(p, l, r, and, 0 ); 
     addRule2(p, -l, 0, -and, 0 ); 
@@ -475,21 +1205,31 @@ int makeBoolAnd(Problem* p, int l, int r) {
     addRule2(p, and, 0, l, r ); 
     addRule2(p, -and, l, -r,0 ); 
     addRule2(p, -and, r, -l,0 ); 
+    addGate(&p->gates, GATE_AND, l, r, and);
     return and;
 }
 
+// not (not l and not r); the rules of the AND gate are those of an OR gate, negated
 int makeBoolOr(Problem* p, int l, int r) {
-    int or = newLit(p);
-    addRule2(p, -l, -r, -or, 0 ); 
-    addRule2(p, l, 0, or, 0 ); 
-    addRule2(p, r, 0, or, 0 ); 
-    addRule2(p, -or, 0, -l, -r ); 
-    addRule2(p, or, -l, r, 0 ); 
-    addRule2(p, or, -r, l, 0 ); 
-    return or;
+    return -makeBoolAnd(p, -l, -r);
 }
 
 int makeBoolXor(Problem* p, int l, int r) {
+    if (l == r) return p->false;
+    if (l == -r) return p->true;
+    if (l == p->false) return r;
+    if (r == p->false) return l;
+    if (l == p->true) return -r;
+    if (r == p->true) return -l;
+    // xor(-l,r) = -xor(l,r)
+    int negate = (l < 0) != (r < 0);
+    if (l < 0) l = -l;
+    if (r < 0) r = -r;
+    if (l > r) {
+        int t = l; l = r; r = t;
+    }
+    Gate* gate = findGate(&p->gates, GATE_XOR, l, r);
+    if (gate->kind != 0) return negate ? -gate->out : gate->out;
     int xor = newLit(p);
     addRule2(p, -l, -r, -xor, 0 ); 
     addRule2(p, -l, r, xor, 0 ); 
@@ -503,35 +1243,28 @@ int makeBoolXor(Problem* p, int l, int r) {
     addRule2(p, xor, -r, l, 0 ); 
     addRule2(p, xor, l, -r, 0 ); 
     addRule2(p, xor, r, -l, 0 ); 
-    return xor;
+    addGate(&p->gates, GATE_XOR, l, r, xor);
+    return negate ? -xor : xor;
 }
 
-
+// not xor; the rules of the XOR gate are those of an EQ gate, negated
 int makeBoolEq(Problem* p, int l, int r) {
-    int eq = newLit(p);
-    addRule2(p, l, r, eq, 0 ); 
-    addRule2(p, -l, -r, eq, 0 ); 
-    addRule2(p, l, -r, -eq, 0 ); 
-    addRule2(p, -l, r, -eq, 0 ); 
-    addRule2(p, eq, l , r, 0 ); 
-    addRule2(p, eq, -l , -r, 0 ); 
-    addRule2(p, eq, r , l, 0 ); 
-    addRule2(p, eq, -r , -l, 0 ); 
-    addRule2(p, -eq, l , -r, 0 ); 
-    addRule2(p, -eq, -l , r, 0 ); 
-    addRule2(p, -eq, r , -l, 0 ); 
-    addRule2(p, -eq, -r , l, 0 ); 
-    return eq;
+    return -makeBoolXor(p, l, r);
 }
 
 int makeBoolImpl(Problem* p, int l, int r) {
+    if (l == p->false || r == p->true || l == r) return p->true;
+    if (l == p->true) return r;
+    if (r == p->false || l == -r) return -l;
+    Gate* gate = findGate(&p->gates, GATE_IMPL, l, r);
+    if (gate->kind != 0) return gate->out;
     int impl = newLit(p);
     addRule2(p, -l, 0, impl, 0 );        
     addRule2(p, l, r, impl, 0 );        
     addRule2(p, l, -r, -impl, 0 );        
     addRule2(p, impl, l, r, 0 );        
     addRule2(p, -impl, 0, l, -r );        
-
+    addGate(&p->gates, GATE_IMPL, l, r, impl);
     return impl;
 }
 
@@ -594,42 +1327,11 @@ List* makeNumber (Problem* problem, int number) {
     return literals;
 }
 
-// substitute bps.c's GetNumber with a signed version 
-int getNumber (Solver* s, int* literals) {
-    int number = 0;
-    int index = 0;
-    // get sign bit
-    int lit = literals[index++];
-    int negative = (s->gMarkers[Literal2Index(lit)]!=0);
-    // get value
-    if (negative) {
-        while ((lit = literals[index++])!=0) {
-            // shift right
-            number <<= 1;
-            // if literal NOT in solution, add 1    - two's complement, invert bits
-            if (s->gMarkers[Literal2Index(lit)]==0) ++number;
-        } 
-        return -(number+1);    // two's complement - add 1
-    }
-    else    // positive
-    {
-        while ((lit = literals[index++])!=0) {
-            // shift right
-            number <<= 1;
-            // if literal in solution, add 1
-            if (s->gMarkers[Literal2Index(lit)]!=0) ++number;
-        } 
-        return number;
-    }
-}
-
-
-
 // return a new number variable 
 List* makeNumVar(Problem* problem) { 
     List* literals = NewList();
     int i;
-    for (i=0;i<NUMBER_WIDTH;i++) {
+    for (i=0;i<gNumberWidth;i++) {
         int lit = newLit(problem);
         ListAppend(literals,lit);
     }
@@ -1365,10 +2067,9 @@ List* makeNumMod (Problem* p, List* left, List* right) {
 
 // ---------- solving expressions  ----------
 
-List* convertExpr(Expr* expr, Problem* p);  // needs to be forward declare due recursion
-
 List* makeEval(Problem* p, Expr* expr) {
-    printf("Solving subproblem for EVAL...");
+    if (gVerbose) printf("Solving subproblem for EVAL...");
+    double start = traceStart();
     if (p == NULL) return NULL;
     if (expr == NULL) return NULL;
     if (expr->left == NULL) return NULL;
@@ -1391,11 +2092,13 @@ List* makeEval(Problem* p, Expr* expr) {
     // solve
     // add a rule to ensure all variables are include
     addRule2(problem, 0,0, problem->maxlit, 0);
-    // convert problem rules to array
-    int* rules = List2Array(problem->rules);
+    // problem rules as solver input
+    int* rules = BufferArray(problem->rules);
     // create solver
-    Solver* solver = NewSolver(rules);
-    free(rules);
+    Solver* solver = newSolver(rules, NULL);
+    double solvestart = traceStart();
+    // only distinct values of the left side are needed
+    setProjection(solver, left);
     
     // we dont need this anymore
     // the new expression is created in the in old context!
@@ -1413,7 +2116,7 @@ List* makeEval(Problem* p, Expr* expr) {
     // evaluate left left side in all solutions
     // assign to literals Or(Eq(var,num1), Eq(var,num2),...)
     int numSol= 0;
-    while (NextSolution(solver)) {
+    while (nextSolution(solver)) {
         ++numSol;
         if (numSol > MAX_SOLUTIONS) {
             printf("\nWARNING: Subproblem has more than %d solutions. EVAL truncated.\n", MAX_SOLUTIONS);
@@ -1421,7 +2124,7 @@ List* makeEval(Problem* p, Expr* expr) {
         }
         int* array = List2Array(left);
         if (array != NULL) { 
-            int num = getNumber(solver, array);
+            int num = GetSignedNumber(solver, array);
             List* numlits = makeNumber(p, num);  // should use same true/false literals  
             List* eqlits = makeNumEq(p, varlits, numlits);
             List* newor = makeNumOr(p, or, eqlits);
@@ -1434,12 +2137,22 @@ List* makeEval(Problem* p, Expr* expr) {
     }
    
     // exhaused 
+    traceSpan("solve", solvestart, solver);
+    int incomplete = solver->gLastResult == LIMIT_REACHED;
     DeleteSolver(solver);
+    // the values found so far are not all values: no result
+    if (incomplete) {
+        DeleteList(or);
+        DeleteList(varlits);
+        return NULL;
+    }
 
     // constrain the result 
     constraintNumConst(p, or, 1);   
 
-    printf("done.\n");
+    traceSpan("EVAL", start, NULL);
+
+    if (gVerbose) printf("done.\n");
 
     return varlits;
 }
@@ -1460,14 +2173,14 @@ Expr* replaceIndirections(Expr* expr, Problem* problem, Solver* solver) {
             varlits = getVariable(problem, left->term);
             if (varlits != NULL) {
                 int* array = List2Array(varlits);
+                DeleteList(varlits);
                 if (array != NULL) { 
-                    int num = getNumber(solver, array);
-                    char* numstr = malloc(10);
-                    snprintf(numstr,10,"%d",num); 
-                    return newExpr(NUM, numstr, NULL, NULL);
+                    int num = GetSignedNumber(solver, array);
                     free(array);
+                    char numstr[16];
+                    snprintf(numstr,16,"%d",num); 
+                    return newExpr(NUM, numstr, NULL, NULL);
                 }
-                DeleteList(varlits);
             }
          } 
          else if (op == VAR) {
@@ -1475,13 +2188,15 @@ Expr* replaceIndirections(Expr* expr, Problem* problem, Solver* solver) {
             varlits = getVariable(problem, term);
             if (varlits != NULL) {
                 int* array = List2Array(varlits);
+                DeleteList(varlits);
                 if (array != NULL) { 
-                    int num = getNumber(solver, array);
-                    char* varname = makeVarName(num); 
-                    return newExpr(VAR, varname, NULL, NULL);
+                    int num = GetSignedNumber(solver, array);
                     free(array);
+                    char* varname = makeVarName(num); 
+                    Expr* varexpr = newExpr(VAR, varname, NULL, NULL);
+                    free(varname);
+                    return varexpr;
                 }
-                DeleteList(varlits);
             }
         } 
         
@@ -1492,9 +2207,28 @@ Expr* replaceIndirections(Expr* expr, Problem* problem, Solver* solver) {
     }
 }  
 
+/* appends the literals of all variables in expr that exist in the problem */
+void addExprLiterals(Problem* problem, Expr* expr, List* literals) {
+    if (expr == NULL) return;
+    if (expr->op == VAR) {
+        List* varlits = getVariable(problem, expr->term);
+        if (varlits != NULL) {
+            Node* node = varlits->first;
+            while (node) {
+                ListAppend(literals, node->value);
+                node = node->next;
+            }
+            DeleteList(varlits);
+        }
+    }
+    addExprLiterals(problem, expr->left, literals);
+    addExprLiterals(problem, expr->right, literals);
+}
+
 /* Indirection solver */
 List* makeInd(Problem* problem, Expr* expr) {
-    printf("Solving subproblem for IND...");
+    if (gVerbose) printf("Solving subproblem for IND...");
+    double start = traceStart();
 
     if (problem == NULL) return NULL;
     if (expr == NULL) return NULL;
@@ -1516,18 +2250,22 @@ List* makeInd(Problem* problem, Expr* expr) {
     // add a rule to ensure all variables are include
     addRule2(new, 0,0, new->maxlit, 0);
     // convert new rules to array
-    int* rules = List2Array(new->rules);
+    int* rules = BufferArray(new->rules);
     // create solver
-    Solver* solver = NewSolver(rules);
-    // we dont need this anymore
-    free(rules);
+    Solver* solver = newSolver(rules, NULL);
+    double solvestart = traceStart();
+    // only distinct values of the variables in the left hand are needed
+    List* leftlits = NewList();
+    addExprLiterals(new, expr->left, leftlits);
+    setProjection(solver, leftlits);
+    DeleteList(leftlits);
 
     // replace all variables in left hand by new variables determined by
     // values of those variables in right hand solutions 
     // result is AND of new expressions
     Expr* newexpr = newExpr(NUM, "1", NULL,NULL);
     int numSol = 0;
-    while (NextSolution(solver)) {
+    while (nextSolution(solver)) {
          ++numSol;
         if (numSol > MAX_SOLUTIONS) {
             printf("\nWARNING: Subproblem has more than %d solutions. IND truncated.\n", MAX_SOLUTIONS);
@@ -1539,18 +2277,24 @@ List* makeInd(Problem* problem, Expr* expr) {
     
     // done solving
     deleteProblem(new);
+    traceSpan("solve", solvestart, solver);
+    int incomplete = solver->gLastResult == LIMIT_REACHED;
     DeleteSolver(solver);
+    // not all solutions: no result
+    if (incomplete) return NULL;
    
-    printf("New problem:\n");
-    printExpr(newexpr,1); 
+    if (gVerbose) {
+        printf("New problem:\n");
+        printExpr(newexpr,1); 
+    }
 
     // convert LHS expression in input context
     List* newlits = convertExpr(newexpr, problem);
-           
-    // delete new expression tree 
-    // TODO: deleteExpr(newexpr);   NOTE: problem is that Expr.term is only sometimes allocated 
+    // the new expression tree is released with the input expression (deleteExprs)
  
-    printf("done.\n");
+    traceSpan("IND", start, NULL);
+
+    if (gVerbose) printf("done.\n");
 
     return newlits;
 }
@@ -1558,7 +2302,8 @@ List* makeInd(Problem* problem, Expr* expr) {
 
 List* makeCount(Problem* p, Expr* expr) {
 
-    printf("Solving subproblem for COUNT...");
+    if (gVerbose) printf("Solving subproblem for COUNT...");
+    double start = traceStart();
     
     if (p == NULL) return NULL;
     if (expr == NULL) return NULL;
@@ -1583,39 +2328,47 @@ List* makeCount(Problem* p, Expr* expr) {
     // solve
     // add a rule to ensure all variables are include
     addRule2(problem, 0,0, problem->maxlit, 0);
-    // convert problem rules to array
-    int* rules = List2Array(problem->rules);
+    // problem rules as solver input
+    int* rules = BufferArray(problem->rules);
     // create solver
-    Solver* solver = NewSolver(rules);
-    free(rules);
+    Solver* solver = newSolver(rules, NULL);
+    double solvestart = traceStart();
     
    
     // count solutions
-    int numSolutions = 0;
-    while (NextSolution(solver)) {
-        numSolutions+=1;
-        if (numSolutions > MAX_SOLUTIONS) {
-            printf("\nWARNING: Subproblem has more than %d solutions. COUNT truncated.\n", MAX_SOLUTIONS);
-            break;
-        }
+    int numSolutions = EnumerateSolutions(solver, NULL, NULL, MAX_SOLUTIONS+1);
+    int incomplete = solver->gLastResult == LIMIT_REACHED;
+    if (incomplete) {
+        printf("\nWARNING: Resource limit reached. Search incomplete.\n");
+        gLimitReached = TRUE;
+    }
+    else if (numSolutions > MAX_SOLUTIONS) {
+        printf("\nWARNING: Subproblem has more than %d solutions. COUNT truncated.\n", MAX_SOLUTIONS);
     }
 
     // exhaused 
+    traceSpan("solve", solvestart, solver);
     DeleteSolver(solver);
 
     // we dont need this anymore
     // the new expression is created in the in old context (p)
     deleteProblem(problem);
+    DeleteList(left);
+    // the count is unknown: no result
+    if (incomplete) return NULL;
  
     // constrain the result 
     List* num = makeNumber(p, numSolutions);
 
-    printf("done.\n");
+    traceSpan("COUNT", start, NULL);
+
+    if (gVerbose) printf("done.\n");
     return num;
 }
 
 List* makeMin(Problem* p, Expr* expr) {
-    printf("Solving subproblem for MIN...");
+    if (gVerbose) printf("Solving subproblem for MIN...");
+    double start = traceStart();
     if (p == NULL) return NULL;
     if (expr == NULL) return NULL;
     if (expr->left == NULL) return NULL;
@@ -1635,54 +2388,38 @@ List* makeMin(Problem* p, Expr* expr) {
     // implicitly constrain right hand to 1
     constraintNumConst(problem, right, 1);
     
-    // create order variable list
-    List* ordered = NewList();
-    // convert to postive value, by adding maximum integer of same length.
-    // needed because 2's complement negetive value not in sort order
-    List* maxint = NewList();
-    ListAppend(maxint, problem->false);       // maxint sign bit false
-    Node* node = left->first;
-    while (node) {
-        ListAppend(maxint, problem->true);        // maxint all other bits true
-        node = node -> next;
-    } 
-    List* positive = makeNumAdd(problem, left, maxint);
-    // add variables(not literals!)to ordered vars list
-    node = positive->first;
-    while (node) {
-        ListAppend(ordered, literal2var(problem, node->value));
-        node = node -> next;
-    }
-
     // add a rule to ensure all variables are include
     addRule2(problem, 0,0, problem->maxlit, 0);
-    // convert problem rules to array
-    int* rules = List2Array(problem->rules);
+    // problem rules as solver input
+    int* rules = BufferArray(problem->rules);
 
-    // create solver with ordered variables
-    Solver* solver = NewSolver2(rules,ordered);
+    // create solver
+    Solver* solver = newSolver(rules, NULL);
+    double solvestart = traceStart();
     
     // we dont need this anymore (local context)
-    free(rules);
-    DeleteList(ordered);
-    DeleteList(maxint);
-    DeleteList(positive); 
     deleteProblem(problem);
     
-    // solve and evaluate left left side in first solution!
+    // solve and evaluate left side in the optimal solution
     int minValue = 0;
     int numSolutions = 0;
-    if (NextSolution(solver)) {
+    if (optimize(solver, left, FALSE)) {
         int* array = List2Array(left);
         if (array != NULL) { 
-            minValue = getNumber(solver, array);
+            minValue = GetSignedNumber(solver, array);
             free(array);
             numSolutions++;
         }
     }
     
     // not needed anymore 
+    traceSpan("solve", solvestart, solver);
+    int incomplete = solver->gLastResult == LIMIT_REACHED;
     DeleteSolver(solver);
+    DeleteList(left);
+    DeleteList(right);
+    // the optimum is unknown (not a conflict): no result
+    if (incomplete) return NULL;
 
     // construct result variables, in global context 
     List* literals;
@@ -1699,13 +2436,16 @@ List* makeMin(Problem* p, Expr* expr) {
         literals = makeNumber(p, minValue);
     }
     
-    printf("done.\n");
+    traceSpan("MIN", start, NULL);
+    
+    if (gVerbose) printf("done.\n");
     
     return literals;
 }
 
 List* makeMax(Problem* p, Expr* expr) {
-    printf("Solving subproblem for MAX...");
+    if (gVerbose) printf("Solving subproblem for MAX...");
+    double start = traceStart();
     if (p == NULL) return NULL;
     if (expr == NULL) return NULL;
     if (expr->left == NULL) return NULL;
@@ -1727,55 +2467,38 @@ List* makeMax(Problem* p, Expr* expr) {
     // implcitlyy constrain right hand to 1
     constraintNumConst(problem, right, 1);
     
-    // create order variable list
-    List* ordered = NewList();
-    // convert to postive value, by subtracting value from maximum integer of same length.
-    // needed because 2's complement negetive value not in sort order
-    List* maxint = NewList();
-    ListAppend(maxint, problem->false);       // maxint sign bit false
-    ListAppend(maxint, problem->true);       // extra bit, because neg range bigger than pos range for 2's comp
-    Node* node = left->first;
-    while (node) {
-        ListAppend(maxint, problem->true);        // maxint all other bits true
-        node = node -> next;
-    } 
-    List* positive = makeNumSub(problem, maxint, left);
-    // add variables(not literals!)to ordered vars list
-    node = positive->first;
-    while (node) {
-        ListAppend(ordered, literal2var(problem, node->value));
-        node = node -> next;
-    }
-
     // add a rule to ensure all variables are include
     addRule2(problem, 0,0, problem->maxlit, 0);
-    // convert problem rules to array
-    int* rules = List2Array(problem->rules);
+    // problem rules as solver input
+    int* rules = BufferArray(problem->rules);
 
-    // create solver with ordered variables
-    Solver* solver = NewSolver2(rules,ordered);
+    // create solver
+    Solver* solver = newSolver(rules, NULL);
+    double solvestart = traceStart();
     
     // we dont need this anymore (local context)
-    free(rules);
-    DeleteList(ordered);
-    DeleteList(maxint);
-    DeleteList(positive); 
     deleteProblem(problem);
     
-    // solve and evaluate left left side in first solution!
+    // solve and evaluate left side in the optimal solution
     int maxValue = 0;
     int numSolutions = 0;
-    if (NextSolution(solver)) {
+    if (optimize(solver, left, TRUE)) {
         int* array = List2Array(left);
         if (array != NULL) { 
-            maxValue = getNumber(solver, array);
-            numSolutions++;
+            maxValue = GetSignedNumber(solver, array);
             free(array);
+            numSolutions++;
         }
     }
     
     // not needed anymore 
+    traceSpan("solve", solvestart, solver);
+    int incomplete = solver->gLastResult == LIMIT_REACHED;
     DeleteSolver(solver);
+    DeleteList(left);
+    DeleteList(right);
+    // the optimum is unknown (not a conflict): no result
+    if (incomplete) return NULL;
 
     // construct result variables, in global context 
     List* literals;
@@ -1792,7 +2515,9 @@ List* makeMax(Problem* p, Expr* expr) {
         literals = makeNumber(p, maxValue);
     }
     
-    printf("done.\n");
+    traceSpan("MAX", start, NULL);
+    
+    if (gVerbose) printf("done.\n");
     
     return literals;
 }
@@ -1802,7 +2527,8 @@ List* makeMax(Problem* p, Expr* expr) {
 // ------------ convert expression - 
 // adds constraints to problem and return a list of variables 
 
-List* convertExpr(Expr* expr, Problem* p) {
+// converts a single expression node; the subexpressions with convertExpr
+List* convertNode(Expr* expr, Problem* p) {
     if (expr == NULL) return NULL;
     List* left = NULL; 
     List* right = NULL; 
@@ -1811,6 +2537,7 @@ List* convertExpr(Expr* expr, Problem* p) {
     // for PNTR 
     Expr* lhs;
     int varno; 
+    char* varname;
         
     switch (expr->op) {
         // var and num have no subexpressions
@@ -1857,7 +2584,24 @@ List* convertExpr(Expr* expr, Problem* p) {
 	    case PNTR:
 	        lhs = (Expr*)expr->left;
 	        varno = atoi(lhs->term);
-	        literals = addOrGetVariable(p, makeVarName(varno));
+	        varname = makeVarName(varno);
+	        literals = addOrGetVariable(p, varname);
+	        free(varname);
+            break;
+
+        // shift left by the constant on the right
+        case SHL:
+            left = convertExpr(expr->left, p);
+            if (left == NULL)
+            {
+                return NULL;
+            }
+            literals = copyList(left);
+            for (varno=atoi(((Expr*)expr->right)->term);varno>0;varno--) {
+                List* shifted = makeNumShiftL(p, literals);
+                DeleteList(literals);
+                literals = shifted;
+            }
             break;
 
         // the evaluation operators convert subexpressions as needed
@@ -1953,114 +2697,284 @@ List* convertExpr(Expr* expr, Problem* p) {
     return literals;
 }
 
+// ---------------- output -------------
+
+Writer* newWriter(FILE* file, int capacity) {
+    Writer* writer = (Writer*)malloc(sizeof(Writer));
+    writer->file = file;
+    writer->count = 0;
+    writer->capacity = capacity > 0 ? capacity : 4096;
+    writer->buffer = (char*)malloc(writer->capacity);
+    return writer;
+}
+
+void deleteWriter(Writer* writer) {
+    if (writer == NULL) return;
+    flushWriter(writer);
+    free(writer->buffer);
+    free(writer);
+}
+
+void writeString(Writer* writer, const char* string, int length) {
+    if (writer->count + length > writer->capacity) {
+        while (writer->count + length > writer->capacity) writer->capacity *= 2;
+        writer->buffer = (char*)realloc(writer->buffer, writer->capacity);
+    }
+    memcpy(writer->buffer + writer->count, string, length);
+    writer->count += length;
+}
+
+// decimal, without printf
+void writeNumber(Writer* writer, int64_t number) {
+    char digits[24];
+    int pos = sizeof(digits);
+    uint64_t magnitude = number < 0 ? -(uint64_t)number : (uint64_t)number;
+    do {
+        digits[--pos] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (number < 0) digits[--pos] = '-';
+    writeString(writer, digits + pos, sizeof(digits) - pos);
+}
+
+void flushWriter(Writer* writer) {
+    if (writer->count > 0) fwrite(writer->buffer, 1, writer->count, writer->file);
+    writer->count = 0;
+}
+
+// little-endian
+void writeInt32(Writer* writer, int32_t number) {
+    uint32_t bits = (uint32_t)number;
+    char bytes[4] = {bits & 0xff, (bits >> 8) & 0xff, (bits >> 16) & 0xff, (bits >> 24) & 0xff};
+    writeString(writer, bytes, 4);
+}
+
+int parseOutputFormat(char* name) {
+    if (strcmp(name, "human") == 0) return FORMAT_HUMAN;
+    if (strcmp(name, "delta") == 0) return FORMAT_DELTA;
+    if (strcmp(name, "csv") == 0) return FORMAT_CSV;
+    if (strcmp(name, "jsonl") == 0) return FORMAT_JSONL;
+    if (strcmp(name, "binary") == 0) return FORMAT_BINARY;
+    return -1;
+}
+
+OutputPlan* newOutputPlan(Problem* p, OutputFormat format) {
+    OutputPlan* plan = (OutputPlan*)malloc(sizeof(OutputPlan));
+    plan->format = format;
+    plan->count = p->symbols.count;
+    plan->names = (char**)malloc((plan->count+1)*sizeof(char*));
+    plan->namelengths = (int*)malloc((plan->count+1)*sizeof(int));
+    plan->values = (int64_t*)malloc((plan->count+1)*sizeof(int64_t));
+    plan->previous = (int64_t*)malloc((plan->count+1)*sizeof(int64_t));
+    plan->written = 0;
+    plan->layout = NewNumberLayout();
+    int* order = sortedSymbols(p);
+    int* literals = (int*)malloc((gNumberWidth+1)*sizeof(int));
+    int i, bit;
+    for (i=0;i<plan->count;i++) {
+        Symbol* symbol = &p->symbols.symbols[order[i]];
+        plan->names[i] = symbol->name;
+        plan->namelengths[i] = strlen(symbol->name);
+        for (bit=0;bit<gNumberWidth;bit++) {
+            literals[bit] = symbol->firstlit + bit;
+        }
+        literals[gNumberWidth] = 0;
+        AddLayoutNumber(plan->layout, literals, TRUE);
+    }
+    free(literals);
+    free(order);
+    return plan;
+}
+
+void deleteOutputPlan(OutputPlan* plan) {
+    if (plan == NULL) return;
+    free(plan->names);
+    free(plan->namelengths);
+    free(plan->values);
+    free(plan->previous);
+    DeleteNumberLayout(plan->layout);
+    free(plan);
+}
+
+// the names of the variables, for the formats that have a header
+void writeHeader(Writer* writer, OutputPlan* plan) {
+    int i;
+    if (plan->format == FORMAT_CSV) {
+        for (i=0;i<plan->count;i++) {
+            if (i > 0) writeString(writer, ",", 1);
+            writeString(writer, plan->names[i], plan->namelengths[i]);
+        }
+        writeString(writer, "\n", 1);
+    }
+    else if (plan->format == FORMAT_BINARY) {
+        writeString(writer, "H", 1);
+        writeInt32(writer, plan->count);
+        for (i=0;i<plan->count;i++) {
+            char length = plan->namelengths[i] < 255 ? plan->namelengths[i] : 255;
+            writeString(writer, &length, 1);
+            writeString(writer, plan->names[i], (unsigned char)length);
+        }
+    }
+}
+
+// writes the values of the variables in the current solution of the solver
+void writeSolution(Writer* writer, OutputPlan* plan, Solver* solver, int number) {
+    // keep the previous values for FORMAT_DELTA
+    int64_t* previous = plan->previous;
+    plan->previous = plan->values;
+    plan->values = previous;
+    GetNumbers(solver, plan->layout, plan->values);
+    int i;
+    switch (plan->format) {
+        case FORMAT_HUMAN:
+        case FORMAT_DELTA:
+            writeString(writer, "Solution #", 10);
+            writeNumber(writer, number);
+            writeString(writer, ":\n", 2);
+            for (i=0;i<plan->count;i++) {
+                if (plan->format == FORMAT_DELTA && plan->written > 0 && plan->values[i] == plan->previous[i]) continue;
+                writeString(writer, " ", 1);
+                writeString(writer, plan->names[i], plan->namelengths[i]);
+                writeString(writer, "=", 1);
+                writeNumber(writer, plan->values[i]);
+                writeString(writer, "\n", 1);
+            }
+            break;
+        case FORMAT_CSV:
+            for (i=0;i<plan->count;i++) {
+                if (i > 0) writeString(writer, ",", 1);
+                writeNumber(writer, plan->values[i]);
+            }
+            writeString(writer, "\n", 1);
+            break;
+        case FORMAT_JSONL:
+            writeString(writer, "{", 1);
+            for (i=0;i<plan->count;i++) {
+                writeString(writer, i > 0 ? ", \"" : "\"", i > 0 ? 3 : 1);
+                writeString(writer, plan->names[i], plan->namelengths[i]);
+                writeString(writer, "\": ", 3);
+                writeNumber(writer, plan->values[i]);
+            }
+            writeString(writer, "}\n", 2);
+            break;
+        case FORMAT_BINARY:
+            writeString(writer, "S", 1);
+            for (i=0;i<plan->count;i++) {
+                writeInt32(writer, (int32_t)plan->values[i]);
+            }
+            break;
+    }
+    plan->written++;
+}
+
+// ---------- profile -------------
+
+// clears the profile, for the next expression
+void startProfile() {
+    gProfileSize = 0;
+    gProfileCurrent = -1;
+}
+
+// attributes the rule statistics of the solver (see EnableRuleStatistics) to the
+// tags of the rules of the problem, and prints the profile of each expression subtree
+void printProfile(Problem* problem, Solver* solver) {
+    if (gProfileSize == 0 || problem->tags == NULL) return;
+    int rule;
+    for (rule=0;rule<problem->tags->count;rule++) {
+        int tag = problem->tags->values[rule];
+        if (tag < 0 || tag >= gProfileSize) continue;
+        ProfileEntry* e = &gProfile[tag];
+        e->solverrules++;
+        if (solver->gRuleStatistics != NULL && rule < solver->gNumberOfRules) {
+            e->firings += solver->gRuleStatistics[rule].firings;
+            e->propagations += solver->gRuleStatistics[rule].propagations;
+            e->conflicts += solver->gRuleStatistics[rule].conflicts;
+        }
+    }
+    // subtrees; children come after their parent
+    int i;
+    for (i=gProfileSize-1;i>=0;i--) {
+        ProfileEntry* e = &gProfile[i];
+        if (e->parent < 0) continue;
+        ProfileEntry* parent = &gProfile[e->parent];
+        parent->solverrules += e->solverrules;
+        parent->firings += e->firings;
+        parent->propagations += e->propagations;
+        parent->conflicts += e->conflicts;
+    }
+    printf("Profile:\n");
+    printf("%10s %9s %9s %9s %10s %12s %10s  %s\n", "seconds", "literals", "rules", "simplified",
+           "firings", "propagations", "conflicts", "expression");
+    for (i=0;i<gProfileSize;i++) {
+        ProfileEntry* e = &gProfile[i];
+        printf("%10.6f %9ld %9ld %9ld %10ld %12ld %10ld  %*s%s\n", e->seconds, e->literals, e->rules,
+               e->solverrules, e->firings, e->propagations, e->conflicts, e->depth, "", e->expr->term);
+    }
+}
+
+// converts the node; with a profile entry if profiling
+List* convertProfiled(Expr* expr, Problem* p) {
+    if (!gProfiling) return convertNode(expr, p);
+    // new entry, a child of the node being converted
+    if (gProfileSize == gProfileCapacity) {
+        gProfileCapacity = gProfileCapacity > 0 ? 2*gProfileCapacity : 64;
+        gProfile = (ProfileEntry*)realloc(gProfile, gProfileCapacity*sizeof(ProfileEntry));
+    }
+    int entry = gProfileSize++;
+    ProfileEntry* e = &gProfile[entry];
+    memset(e, 0, sizeof(ProfileEntry));
+    e->expr = expr;
+    e->parent = gProfileCurrent;
+    e->depth = gProfileCurrent >= 0 ? gProfile[gProfileCurrent].depth+1 : 0;
+    // convert, with this node as tag for the new rules
+    int maxlit = p->maxlit;
+    int numrules = p->numrules;
+    double start = wallTime();
+    gProfileCurrent = entry;
+    List* literals = convertNode(expr, p);
+    gProfileCurrent = gProfile[entry].parent;
+    // note: the recursion may have moved the entries
+    e = &gProfile[entry];
+    e->seconds = wallTime() - start;
+    e->literals = p->maxlit - maxlit;
+    e->rules = p->numrules - numrules;
+    return literals;
+}
+
+// a shared expression is converted once per problem
+List* convertExpr(Expr* expr, Problem* p) {
+    if (expr == NULL) return NULL;
+    if (expr->refs > 1) {
+        List* literals = getConversion(&p->conversions, expr);
+        if (literals != NULL) return copyList(literals);
+    }
+    List* literals = convertProfiled(expr, p);
+    if (expr->refs > 1 && literals != NULL) addConversion(&p->conversions, expr, literals);
+    return literals;
+}
+
 // experimental
 Problem* Simplify(Problem* problem, List* expression) {
 
-    // convert problem rules to array
-    int* rules = List2Array(problem->rules);
+    // problem rules as solver input
+    int* rules = BufferArray(problem->rules);
     // create solver
     Solver* s = NewSolver(rules);
-    free(rules);
 
-    printf("Simplify...\n");
+    if (gVerbose) printf("Simplify...\n");
     
      // print some statistics
-    printf("%d variables\n", s->gNumberOfVariables);
-    printf("%d rules\n", s->gNumberOfRules);
+    if (gVerbose) printf("%d variables\n", s->gNumberOfVariables);
+    if (gVerbose) printf("%d rules\n", s->gNumberOfRules);
     
     // mark time
     struct timeval tv1;
     gettimeofday(&tv1,NULL);
 
-    // ---- snip taken from NextSolution ----
-    // basically perform one forward propagation step, but make no choice.
-    
-    // propagate all literals for which the antagonist cannot be propagated
-    int lastcount = -1;
-    int i = 0;
-    int backtrack = 0;
-    while (s->gFreeVars->count != lastcount) { 
-        lastcount = s->gFreeVars->count;
-        i++;
-        DEBUGPRINTF("Iter %d, color=%d freevars=%d\n", i, s->gColor,s->gFreeVars->count);
-    
-        // unfortunately need to copy because order of s->gFreeVars can change during (Un)Propagate
-        // NOTE: A simply linked list stack or queue would be suffient too!
-        // Or maybe we can change the order in which variables are pushed onto s->gFreeVars?
-
-        Set* freevarscopy = NewSet(s->gNumberOfVariables+1);
-        Node* freevar = s->gFreeVars->first;
-        while (freevar) {
-            AddSet(freevarscopy, freevar->value, FALSE);
-            freevar = freevar -> next;
-        }
-
-        freevar = freevarscopy->first;
-        while (freevar) {
-            int var = freevar->value;
-            // check that var is still free
-            if (GetSetNode(s->gFreeVars, var) == NULL) { 
-                DEBUGPRINTF("Skip literal %d color=%d freevars=%d\n",+var, s->gColor, s->gFreeVars->count);
-                ASSERT(s->gMarkers[Literal2Index(var)]!=0 || s->gMarkers[Literal2Index(-var)]!=0);
-                freevar = freevar->next;
-                continue;
-            }
-            ASSERT(s->gMarkers[Literal2Index(var)]==0 && s->gMarkers[Literal2Index(-var)]==0);
-            int count1 = s->gFreeVars->count;
-            int total1 = s->gTotalCount;
-           
-            // try TRUE
-            int pos = Propagate(s, +var, -1, FALSE);   // color -1, does not conflict with Fixes and Choices! 
-            Unpropagate(s, +var, -1, FALSE);
-            // try FALSE
-            int neg = Propagate(s, -var, -1, FALSE);   // color -1, does not conflict with Fixes and Choices! 
-            Unpropagate(s, -var, -1, FALSE);
-            
-            int count2 = s->gFreeVars->count;
-            int total2 = s->gTotalCount;
-            ASSERT(count1==count2);
-            ASSERT(total1==total2);
-
-            // which combination?
-            if (pos && !neg) { 
-                s->gColor+=1;
-                ASSERT(Propagate(s, +var, s->gColor, TRUE));
-                DEBUGPRINTF("Fix literal %d color=%d freevars=%d\n",+var, s->gColor, s->gFreeVars->count);
-                // push special value on stack
-                Node* newstack = NewNode(var + 2*s->gNumberOfVariables);
-                newstack->next = s->gStack;  
-                s->gStack = newstack;
-            }
-            else if (neg && !pos) {
-                s->gColor+=1;
-                ASSERT(Propagate(s, -var, s->gColor, TRUE));
-                DEBUGPRINTF("Fix literal %d color=%d freevars=%d\n",-var, s->gColor, s->gFreeVars->count);
-                // push special value on stack
-                Node* newstack = NewNode(-var + 2*s->gNumberOfVariables);
-                newstack->next = s->gStack;  
-                s->gStack = newstack;
-            }
-            else if (!neg && !pos) 
-            {    
-                DEBUGPRINTF("No options for variable %d\n",var);
-                // conflict! Backtrack
-                // return Backtrack();
-                backtrack = 1;
-                break;
-            }
-            else {
-                DEBUGPRINTF("Keep free variable %d\n",var);
-            }
-            freevar = freevar->next;
-        }   // for
-    
-        DeleteSet(freevarscopy);
-
-        // conflict - no solutions, what should we return?    
-        if (backtrack == 1) break;
-    }  // while 
-
-    // ------------- end snippit -----------
+    // perform one forward propagation step of the solver, but make no choice.
+    double probestart = traceStart();
+    int backtrack = !Probe(s);
+    traceSpan("probe", probestart, s);
     
     // -------- create new problem
     Problem* newpro = newProblem();
@@ -2070,6 +2984,7 @@ Problem* Simplify(Problem* problem, List* expression) {
         // add conflict to problem
         addRule2(newpro, newpro->false, 0, newpro->true, 0);
         addRule2(newpro, newpro->true, 0, newpro->false, 0);
+        DeleteSolver(s);
         return newpro;
      };   
 
@@ -2083,17 +2998,15 @@ Problem* Simplify(Problem* problem, List* expression) {
     }
 
    // ------- keep variables in new problem
-    int numbervar;
-    for (numbervar=0;numbervar<MAX_VARS;numbervar++) {
-        int lit = problem->var2lit[numbervar];
-        if (lit != 0) {
-            int i = 0;
-            for (i=0;i<NUMBER_WIDTH;i++) {
-                map[lit+i] = newLit(newpro);
-                //printf("map %d -> var %d\n", lit+i,map[lit+i]);
-            }
-            newpro->var2lit[numbervar] = map[lit];
+    int symbol;
+    for (symbol=0;symbol<problem->symbols.count;symbol++) {
+        int lit = problem->symbols.symbols[symbol].firstlit;
+        int i = 0;
+        for (i=0;i<gNumberWidth;i++) {
+            map[lit+i] = newLit(newpro);
+            //printf("map %d -> var %d\n", lit+i,map[lit+i]);
         }
+        addSymbol(newpro, problem->symbols.symbols[symbol].name, map[lit]);
     }
     
     // for each unmapped var, if not free, then map to fixed true/false
@@ -2130,40 +3043,33 @@ Problem* Simplify(Problem* problem, List* expression) {
     }
 
      // -------- map rules of old problem to new problem ---- 
-    node = problem->rules->first;
-    List* newrules = NewList();
-    while (node != NULL) {
-        int lit = node->value;
-        if (lit >= 0)
-            lit = map[lit];
-        else
-            lit = -map[-lit];
-        ASSERT(node->value == 0 || lit != 0);
-        ListAppend(newrules, lit);
-        //ListAppend(newpro->rules, lit);
-        node = node->next;
-    }
-
     // remove rules that are redundant 
     // and remove duplicate literals in lhs (and rhs) of rules (unsupported by solver, rule counters will be wrong!)
 
-    node = newrules->first;
+    int numvalues = problem->rules->count;
+    int pos = 0;
+    int rule = 0;
     Set* lhs = NewSet(Literal2Index(newpro->maxlit+1));
     Set* rhs = NewSet(Literal2Index(newpro->maxlit+1));
-    while (node != NULL) {
+    while (pos < numvalues) {
+        // tag of the rule, if profiling
+        int tag = problem->tags != NULL && rule < problem->tags->count ? problem->tags->values[rule] : -1;
+        rule++;
         // parse lhs
-        while (node != NULL) {
-            int value = node->value;
-            node = node -> next;
+        while (pos < numvalues) {
+            int value = rules[pos++];
             if (value == 0) break;          //. end of lhs
+            value = value >= 0 ? map[value] : -map[-value];
+            ASSERT(value != 0);
             if (value != problem->true)      // ignore TRUE
                 AddSet(lhs, Literal2Index(value), 0);   
         }
         // parse rhs
-        while (node != NULL) {
-            int value = node->value;
-            node = node -> next;
+        while (pos < numvalues) {
+            int value = rules[pos++];
             if (value == 0) break;          // end of rhs
+            value = value >= 0 ? map[value] : -map[-value];
+            ASSERT(value != 0);
             if (value != problem->true)     // ignore TRUE  
                 AddSet(rhs, Literal2Index(value), 0);   
         }
@@ -2177,20 +3083,21 @@ Problem* Simplify(Problem* problem, List* expression) {
 
         // rule to newproblem if not skipped
         if (skip == 0) {
+            tagRule(newpro, tag);
             // write lhs to newproblem
             Node* setnode = lhs->first;
             while (setnode != NULL) {
-                ListAppend(newpro->rules, Index2Literal(setnode->value));
+                BufferAppend(newpro->rules, Index2Literal(setnode->value));
                 setnode = setnode->next;
             }
-            ListAppend(newpro->rules, 0);      // end lhs
+            BufferAppend(newpro->rules, 0);      // end lhs
             // write rhs to newproblem
             setnode = rhs->first;
             while (setnode != NULL) {
-                ListAppend(newpro->rules, Index2Literal(setnode->value));
+                BufferAppend(newpro->rules, Index2Literal(setnode->value));
                 setnode = setnode->next;
             }
-            ListAppend(newpro->rules, 0);      // end rhs
+            BufferAppend(newpro->rules, 0);      // end rhs
         }
         else {
         }
@@ -2212,7 +3119,6 @@ Problem* Simplify(Problem* problem, List* expression) {
     // remove temp rules
     DeleteSet(lhs);
     DeleteSet(rhs);
-    DeleteList(newrules);
     free(map);
     
      // mark time
@@ -2224,185 +3130,10 @@ Problem* Simplify(Problem* problem, List* expression) {
     double t2 = (double)tv2.tv_sec + ((double)tv2.tv_usec) * 1e-6;
 
     // more statistics
-    printf("%d propagations\n", s->gNumProp);
-    printf("%f seconds\n", t2-t1);
+    if (gVerbose) printf("%d propagations\n", s->gNumProp);
+    if (gVerbose) printf("%f seconds\n", t2-t1);
 
+    DeleteSolver(s);
     return newpro;
     
 } // Simplify
-
-    
-// -------------------------- main -------------------
-
-int main(int argc, char** argv) {
-
-    // open input; defaults to stdin
-    FILE* input = stdin;
-    if (argc >=2) {
-        char* inputfilename = argv[1];
-        input = fopen(inputfilename, "rt");
-        if (input == NULL) { 
-            printf("failed to open file %s\n",inputfilename);
-            return 1;
-        }
-    }
-
-    while (!feof(input)) { 
-    
-        Problem* problem = newProblem();
-        
-        // parse expression
-        Expr* expr = parseExpr(input);
-        if (expr == NULL) {
-            printf("End of Input.\n");
-            deleteProblem(problem);
-            continue;
-        }
-    
-        // if expr is numerical, impicityly prepend CON=?1
-        // else if expr is boolean, impicityly prepend CON
-            switch (expr->op) {
-                case VAR: 
-                case PNTR: 
-                case NUM:
-                case EVAL:
-                case MIN: 
-                case MAX: 
-                case COUNT: 
-                case NEG:
-                case ADD:
-                case SUB:
-                case MUL:
-                case DIV:
-                case MOD:
-                    expr = newExpr(CON, "@", newExpr(EQ, "=", newExpr(VAR,"?1",NULL,NULL),expr),NULL);        
-                    break;
-
-                case NOT:
-                case IND:
-                case EQ:
-                case IMPL:
-                case AND:
-                case OR:
-                case XOR:
-                case LT:
-                case GT:
-                    expr = newExpr(CON, "@",expr,NULL);        
-                    break;
-                
-                case CON:
-                    break;
-        }   
-
-        // inform user of interpretation
-        printExpr(expr,1);
-     
-         // create boolean problem
-        List* literals = convertExpr(expr, problem);
-        if (literals == NULL) {
-            deleteProblem(problem);
-            printf("Error: Invalid expression\n");
-            continue;
-        }
-     
-        // ---- simplify problem
-         
-        // mark time
-        struct timeval tv0;
-        gettimeofday(&tv0,NULL);
-
-       
-        // add a rule to ensure all variables are included
-        addRule2(problem, 0,0, problem->maxlit, 0);
-
-        // simplify and substitute old problem
-        // note: litrerals is changed in place!
-        Problem* newProblem = Simplify(problem, literals);
-        deleteProblem(problem);
-        problem = newProblem;
-            
-        // ------- solve problem  -----
- 
-        // mark time
-        struct timeval tv1;
-        gettimeofday(&tv1,NULL);
-
-       
-        // add a rule to ensure all variables are include
-        addRule2(problem, 0,0, problem->maxlit, 0);
-
-        // convert problem rules to array
-        int* rules = List2Array(problem->rules);
-        // create solver
-        Solver* solver = NewSolver(rules);
-        free(rules);
-
-        // print some statistics
-        printf("Solving...\n");
-        printf("%d variables\n", solver->gNumberOfVariables);
-        printf("%d rules\n", solver->gNumberOfRules);
-        
-        // print solutions
-        int numSol = 0;
-        while (NextSolution(solver)) {
-            ++numSol;
-            if (numSol > MAX_SOLUTIONS) {
-                printf("WARNING: Problem has more than %d solutions. Result truncated.\n", MAX_SOLUTIONS);
-                break;
-            }
-            printf("Solution #%d:\n",numSol);
-            // print all variables
-            int var;
-            for (var=1;var<MAX_VARS;var++) {
-                char* varname = makeVarName(var); 
-                List* varlits = getVariable(problem, varname); 
-                if (varlits != NULL) {
-                    int* array = List2Array(varlits);
-                    if (array != NULL) { 
-                        int num = getNumber(solver, array);
-                        printf(" %s=%d\n", varname, num);
-                        free(array);
-                    }
-                    DeleteList(varlits);
-                }
-                free(varname);
-            }
-            /*
-            // answer to expresion
-            int* array = List2Array(literals);
-            if (array != NULL) { 
-                int num = getNumber(solver, array);
-                printf(" %s=%d\n", "ans", num);
-                free(array);
-            }
-            */
-        }
-        
-
-      
-
-        // mark time
-        struct timeval tv2;
-        gettimeofday(&tv2,NULL);
-
-        // compute time in seconds
-        double t0 = (double)tv0.tv_sec + ((double)tv0.tv_usec) * 1e-6;
-        double t1 = (double)tv1.tv_sec + ((double)tv1.tv_usec) * 1e-6;
-        double t2 = (double)tv2.tv_sec + ((double)tv2.tv_usec) * 1e-6;
-
-        // more statistics
-        printf("%d solutions\n",numSol);
-        printf("%d propagations\n", solver->gNumProp);
-        printf("%d choices\n", solver->gNumChoice);
-        printf("simplify %f seconds\n", t1-t0);
-        printf("solve %f seconds\n", t2-t1);
-        printf("total %f seconds\n", t2-t0);
-   
-        // clean up
-        DeleteSolver(solver);
-        DeleteList(literals); 
-        deleteProblem(problem);
-    }   // while !eof
-    return 0;
-} // main
-
@@ -23,11 +23,28 @@ or
   
     testbps <infile> 
 
+or
+
+    testbps -c <checkpointfile> <infile>
+
+or 
+
+    testbps -s
+
 When <infile> is given, rules are read from file but number inputs are read
 from stdin.  If no <infile> is given,  rules and input are read from stdin.
 (Actually, suppossed to read from file first, then stdin, but transition is
 buggy)
 
+With -c, the state of the search is saved to <checkpointfile> periodically.
+If the checkpoint file exists when the program starts, the search resumes 
+from the saved state. Solutions found after the last checkpoint are found 
+again. The checkpoint file is removed when the search is complete. 
+
+With -s, the program checks the solver API against a full enumeration of 
+the solutions of small generated problems, and prints the failed checks. 
+It exits with status 1 if a check fails.
+
 Input format: 
 
 Input consists of a sequence of decimal integers sepearated by whitespace.
@@ -59,8 +76,11 @@ complement represenation to a decimal number and print it on stdout.
 #include <stdio.h>
 #include <malloc.h>
 #include <stdlib.h>
+#include <string.h>
 #include "bps.h"
 
+#define CHECKPOINT_SECONDS 10.0     // time between checkpoints
+
 // local problem data types
 
 typedef struct { 
@@ -168,12 +188,458 @@ void TestSetNumber (TestNode* node, int number) {
 }
 
 
+/* Saves the state of the solver to a checkpoint file. 
+   Writes a temporary file first, so an existing checkpoint is replaced only by a complete one.
+*/
+void TestSaveCheckpoint (Solver* s, char* filename) {
+    char* tempname = malloc(strlen(filename)+5);
+    sprintf(tempname, "%s.tmp", filename);
+    FILE* file = fopen(tempname, "wt");
+    if (file == NULL || !SaveSolverState(s, file)) {
+        printf("failed to write checkpoint %s\n", tempname);
+    }
+    if (file != NULL) { 
+        fclose(file);
+        rename(tempname, filename);
+    }
+    free(tempname);
+}
+
+// ------------- self checks -----------
+
+#define CHECK_PROBLEMS 50       // number of generated problems
+#define CHECK_VARIABLES 12      // variables of a generated problem; solutions are bit masks
+#define CHECK_RULES 14          // rules of a generated problem
+
+int gNumberOfChecks = 0;
+int gNumberOfFailedChecks = 0;
+unsigned int gCheckRandom = 1;
+
+// counts a check, and prints it if it fails 
+void TestCheck (int ok, char* what, int problem) {
+    gNumberOfChecks++;
+    if (!ok) {
+        gNumberOfFailedChecks++;
+        printf("check failed: %s (problem %d)\n", what, problem);
+    }
+}
+
+// random number 0 <= r < n, the same sequence in every run
+int TestRandom (int n) {
+    gCheckRandom = gCheckRandom * 1103515245u + 12345u;
+    return (int)((gCheckRandom >> 16) % (unsigned int)n);
+}
+
+// random literal of a variable 1..CHECK_VARIABLES
+int TestRandomLiteral () {
+    int var = TestRandom(CHECK_VARIABLES) + 1;
+    return TestRandom(2) ? var : -var;
+}
+
+/* Generates a problem of CHECK_RULES random rules with two input literals and
+   one output literal. A last rule n -> n makes sure the solver has 
+   CHECK_VARIABLES variables.
+*/
+int* NewCheckProblem () {
+    int* problem = (int*)malloc((5*CHECK_RULES+6)*sizeof(int));
+    int index = 0;
+    int r;
+    for (r=0;r<CHECK_RULES;r++) {
+        problem[index++] = TestRandomLiteral();
+        problem[index++] = TestRandomLiteral();
+        problem[index++] = 0;
+        problem[index++] = TestRandomLiteral();
+        problem[index++] = 0;
+    }
+    problem[index++] = CHECK_VARIABLES;
+    problem[index++] = 0;
+    problem[index++] = CHECK_VARIABLES;
+    problem[index++] = 0;
+    problem[index++] = 0;
+    problem[index++] = 0;
+    return problem;
+}
+
+// widths of the numbers in TestCheckNumbers; not all multiples of 4
+int gCheckWidths[] = {3, 4, 5, 7, 12, 0};
+
+// literals of a number of the given width in TestCheckNumbers, zero terminated
+void TestNumberLiterals (int width, int* literals) {
+    int i;
+    for (i=0;i<width;i++) literals[i] = (i % 3 == 1) ? -(i+1) : i+1;
+    literals[width] = 0;
+}
+
+/* Checks GetNumbers in every solution of a problem against TestGetNumber,
+   GetNumber and GetSignedNumber, for unsigned and signed numbers of the
+   first variables. Some literals are negative, so a number is not just
+   the bits of the solution mask.
+*/
+void TestCheckNumbers (int* problem, int p) {
+    int literals[CHECK_VARIABLES+1];
+    TestNode* nodes[CHECK_VARIABLES];
+    NumberLayout* layout = NewNumberLayout();
+    int w,i;
+    for (w=0;gCheckWidths[w]!=0;w++) {
+        // the literals as a list, and in the layout as unsigned and signed number
+        TestNumberLiterals(gCheckWidths[w], literals);
+        TestNode* last = NULL;
+        for (i=0;i<gCheckWidths[w];i++) {
+            TestNode* node = NewTestNode(literals[i]);
+            if (last == NULL) nodes[w] = node; else last->next = node;
+            last = node;
+        }
+        AddLayoutNumber(layout, literals, FALSE);
+        AddLayoutNumber(layout, literals, TRUE);
+    }
+    int64_t* numbers = (int64_t*)malloc(layout->count*sizeof(int64_t));
+    int unsignedok = 1;
+    int signedok = 1;
+    Solver* s = NewSolver(problem);
+    while (NextSolution(s) == SOLUTION_FOUND) {
+        GetNumbers(s, layout, numbers);
+        for (w=0;gCheckWidths[w]!=0;w++) {
+            int width = gCheckWidths[w];
+            TestNumberLiterals(width, literals);
+            int number = TestGetNumber(s, nodes[w]);
+            if (numbers[2*w] != number || GetNumber(s, literals) != number) unsignedok = 0;
+            // two's complement: the first bit has weight -2^(width-1)
+            if (number & (1 << (width-1))) number -= 1 << width;
+            if (numbers[2*w+1] != number || GetSignedNumber(s, literals) != number) signedok = 0;
+        }
+    }
+    TestCheck(unsignedok, "GetNumbers equals TestGetNumber", p);
+    TestCheck(signedok, "GetNumbers sign-extends signed numbers", p);
+    DeleteSolver(s);
+    free(numbers);
+    DeleteNumberLayout(layout);
+    for (w=0;gCheckWidths[w]!=0;w++) {
+        while (nodes[w] != NULL) {
+            TestNode* next = nodes[w]->next;
+            free(nodes[w]);
+            nodes[w] = next;
+        }
+    }
+}
+
+// the current solution as a bit mask of the variables that are true
+int TestSolutionMask (Solver* s) {
+    int mask = 0;
+    int v;
+    for (v=1;v<=s->gNumberOfVariables;v++)
+        if (s->gMarkers[Literal2Index(v)]!=0) mask |= 1 << (v-1);
+    return mask;
+}
+
+// finds all solutions of a problem without limits; returns the number of solutions
+int TestEnumerate (int* problem, int* masks) {
+    Solver* s = NewSolver(problem);
+    int count = 0;
+    while (NextSolution(s) == SOLUTION_FOUND) masks[count++] = TestSolutionMask(s);
+    DeleteSolver(s);
+    return count;
+}
+
+int TestCompareMasks (const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+// returns non-zero if two arrays of solution masks hold the same solutions, each once; sorts them 
+int TestSameSolutions (int* a, int na, int* b, int nb) {
+    if (na != nb) return 0;
+    qsort(a, na, sizeof(int), TestCompareMasks);
+    qsort(b, nb, sizeof(int), TestCompareMasks);
+    int i;
+    for (i=0;i<na;i++) {
+        if (a[i] != b[i]) return 0;
+        if (i > 0 && a[i] == a[i-1]) return 0;
+    }
+    return 1;
+}
+
+/* Checks that a search that is stopped by a call limit, or by InterruptSolver,
+   and then resumed, finds the same solutions as the search without limits.
+*/
+void TestCheckLimits (int* problem, int p, int* all, int count) {
+    int* found = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    // a small propagation limit for each call
+    Solver* s = NewSolver(problem);
+    Limits limits = {0};
+    limits.propagations = 3;
+    SetLimits(s, NULL, &limits);
+    int numfound = 0;
+    int numlimits = 0;
+    int result;
+    while ((result = NextSolution(s)) != SEARCH_EXHAUSTED) {
+        if (result == LIMIT_REACHED) numlimits++;
+        else if (numfound < (1 << CHECK_VARIABLES)) found[numfound++] = TestSolutionMask(s);
+    }
+    TestCheck(numlimits > 0, "propagation limit is reached", p);
+    TestCheck(TestSameSolutions(all, count, found, numfound), "resuming after LIMIT_REACHED finds all solutions", p);
+    DeleteSolver(s);
+    // interrupt before every other call
+    s = NewSolver(problem);
+    numfound = 0;
+    int interrupted = 1;
+    int call = 0;
+    do {
+        int interrupt = (call++ % 2 == 0);
+        if (interrupt) InterruptSolver(s);
+        result = NextSolution(s);
+        if (interrupt && result != LIMIT_REACHED) interrupted = 0;
+        if (result == SOLUTION_FOUND && numfound < (1 << CHECK_VARIABLES)) found[numfound++] = TestSolutionMask(s);
+    } while (result != SEARCH_EXHAUSTED);
+    TestCheck(interrupted, "NextSolution returns LIMIT_REACHED after InterruptSolver", p);
+    TestCheck(TestSameSolutions(all, count, found, numfound), "resuming after InterruptSolver finds all solutions", p);
+    DeleteSolver(s);
+    free(found);
+}
+
+// solutions collected by TestCollectSolution
+typedef struct {
+    int* masks;
+    int count;
+    int start;          // count at the start of the current EnumerateSolutions
+    int stopat;         // stop after this many solutions of a call; 0 to continue
+    int indexok;        // zero if a view had the wrong index
+} TestCollection;
+
+// callback of EnumerateSolutions; stores the solution of the view as a bit mask
+int TestCollectSolution (const SolutionView* view, void* userdata) {
+    TestCollection* collection = (TestCollection*)userdata;
+    int mask = 0;
+    int v;
+    for (v=1;v<=view->numberOfVariables;v++)
+        if (VIEWVALUE(view, v)) mask |= 1 << (v-1);
+    collection->masks[collection->count++] = mask;
+    if (view->index != collection->count - collection->start) collection->indexok = 0;
+    return collection->stopat == 0 || view->index < collection->stopat;
+}
+
+/* Checks that EnumerateSolutions finds the same solutions as NextSolution, 
+   also when it is stopped by its limit or by the callback and then continued.
+*/
+void TestCheckEnumerate (int* problem, int p, int* all, int count) {
+    TestCollection collection;
+    collection.masks = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    collection.count = 0;
+    collection.start = 0;
+    collection.stopat = 0;
+    collection.indexok = 1;
+    Solver* s = NewSolver(problem);
+    long found = EnumerateSolutions(s, TestCollectSolution, &collection, 0);
+    TestCheck(found == count && collection.indexok && s->gLastResult == SEARCH_EXHAUSTED, "EnumerateSolutions counts all solutions", p);
+    TestCheck(TestSameSolutions(all, count, collection.masks, collection.count), "EnumerateSolutions views all solutions", p);
+    DeleteSolver(s);
+    // stop after 5 solutions, then after 3 in the callback, then continue 
+    s = NewSolver(problem);
+    collection.count = 0;
+    long first = EnumerateSolutions(s, TestCollectSolution, &collection, 5);
+    collection.start = collection.count;
+    collection.stopat = 3;
+    long second = EnumerateSolutions(s, TestCollectSolution, &collection, 0);
+    collection.start = collection.count;
+    collection.stopat = 0;
+    EnumerateSolutions(s, TestCollectSolution, &collection, 0);
+    TestCheck(first == (count < 5 ? count : 5) && second == (count-first < 3 ? count-first : 3) && collection.indexok, 
+        "EnumerateSolutions stops at its limit and when the callback returns zero", p);
+    TestCheck(TestSameSolutions(all, count, collection.masks, collection.count), "continued EnumerateSolutions finds all solutions", p);
+    DeleteSolver(s);
+    free(collection.masks);
+}
+
+/* Checks that a projected search finds each distinct assignment of the 
+   projected variables once, with a completion that is a solution, and that
+   clearing the projection gives all solutions again. 
+*/
+void TestCheckProjection (int* problem, int p, int* all, int count) {
+    // random variables to project on, and their bit mask
+    int vars[CHECK_VARIABLES+1];
+    int numvars = TestRandom(CHECK_VARIABLES/2) + 1;
+    int projection = 0;
+    int i;
+    for (i=0;i<numvars;i++) {
+        vars[i] = TestRandomLiteral();
+        projection |= 1 << (abs(vars[i])-1);
+    }
+    vars[numvars] = 0;
+    // distinct projections of all solutions
+    int* projected = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    int numprojected = 0;
+    for (i=0;i<count;i++) projected[i] = all[i] & projection;
+    qsort(projected, count, sizeof(int), TestCompareMasks);
+    for (i=0;i<count;i++)
+        if (i == 0 || projected[i] != projected[numprojected-1]) projected[numprojected++] = projected[i];
+    // projected search
+    int* found = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    int numfound = 0;
+    int solutionsok = 1;
+    Solver* s = NewSolver(problem);
+    SetProjection(s, vars);
+    while (NextSolution(s) == SOLUTION_FOUND && numfound < (1 << CHECK_VARIABLES)) {
+        int mask = TestSolutionMask(s);
+        if (bsearch(&mask, all, count, sizeof(int), TestCompareMasks) == NULL) solutionsok = 0;
+        found[numfound++] = mask & projection;
+    }
+    TestCheck(solutionsok, "projected solutions are solutions", p);
+    TestCheck(TestSameSolutions(projected, numprojected, found, numfound), "projected solutions are the distinct projections", p);
+    DeleteSolver(s);
+    // cleared projection
+    s = NewSolver(problem);
+    SetProjection(s, vars);
+    SetProjection(s, NULL);
+    numfound = 0;
+    while (NextSolution(s) == SOLUTION_FOUND && numfound < (1 << CHECK_VARIABLES)) 
+        found[numfound++] = TestSolutionMask(s);
+    TestCheck(TestSameSolutions(all, count, found, numfound), "SetProjection(NULL) clears the projection", p);
+    DeleteSolver(s);
+    free(found);
+    free(projected);
+}
+
+// a random objective of 1 to 6 random literals
+void TestRandomObjective (Objective* objective, int* literals) {
+    int n = TestRandom(6) + 1;
+    int i;
+    for (i=0;i<n;i++) literals[i] = TestRandomLiteral();
+    literals[n] = 0;
+    objective->literals = literals;
+    objective->isSigned = TestRandom(2);
+    objective->maximize = TestRandom(2);
+}
+
+// value of an objective in a solution mask
+int TestObjectiveValue (Objective* objective, int mask) {
+    int value = 0;
+    int n;
+    for (n=0;objective->literals[n]!=0;n++) {
+        int lit = objective->literals[n];
+        int bit = ((mask >> (abs(lit)-1)) & 1) == (lit > 0);
+        value = 2*value + bit;
+    }
+    // two's complement: the first bit has weight -2^(n-1)
+    if (objective->isSigned && (value & (1 << (n-1)))) value -= 1 << n;
+    return value;
+}
+
+// returns non-zero if solution mask a is better than b for an objective
+int TestBetter (Objective* objective, int a, int b) {
+    int va = TestObjectiveValue(objective, a);
+    int vb = TestObjectiveValue(objective, b);
+    return objective->maximize ? va > vb : va < vb;
+}
+
+/* Checks Optimize with two objectives against the optimum of the solutions 
+   found by the search without limits. With the assumptions that Optimize keeps,
+   NextSolution must find the other optimal solutions, and after ClearAssumptions
+   all solutions. An Optimize that reaches a limit must give the same optimum 
+   after ClearAssumptions.
+*/
+void TestCheckOptimize (int* problem, int p, int* all, int count) {
+    Objective objectives[2];
+    int literals[2][8];
+    TestRandomObjective(&objectives[0], literals[0]);
+    TestRandomObjective(&objectives[1], literals[1]);
+    // lexicographic optimum, and the optimal solutions
+    int* optimal = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    int numoptimal = 0;
+    int i;
+    for (i=0;i<count;i++) {
+        if (numoptimal > 0) {
+            int o = 0;
+            while (o < 2 && TestObjectiveValue(&objectives[o], all[i]) == TestObjectiveValue(&objectives[o], optimal[0])) o++;
+            if (o < 2 && TestBetter(&objectives[o], all[i], optimal[0])) numoptimal = 0;
+            else if (o < 2) continue;
+        }
+        optimal[numoptimal++] = all[i];
+    }
+    int* found = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    int numfound = 0;
+    Solver* s = NewSolver(problem);
+    int result = Optimize(s, objectives, 2);
+    int propagations = s->gNumProp;
+    TestCheck(result == (count > 0 ? SOLUTION_FOUND : SEARCH_EXHAUSTED), "Optimize finds a solution if there is one", p);
+    if (result == SOLUTION_FOUND) {
+        int mask = TestSolutionMask(s);
+        TestCheck(count > 0 && TestObjectiveValue(&objectives[0], mask) == TestObjectiveValue(&objectives[0], optimal[0])
+            && TestObjectiveValue(&objectives[1], mask) == TestObjectiveValue(&objectives[1], optimal[0]), "Optimize finds the optimum", p);
+        // the other optimal solutions, within the assumptions
+        do {
+            if (numfound < (1 << CHECK_VARIABLES)) found[numfound++] = TestSolutionMask(s);
+        } while (NextSolution(s) == SOLUTION_FOUND);
+        TestCheck(TestSameSolutions(optimal, numoptimal, found, numfound), "NextSolution after Optimize finds the optimal solutions", p);
+        ClearAssumptions(s);
+        numfound = 0;
+        while (NextSolution(s) == SOLUTION_FOUND && numfound < (1 << CHECK_VARIABLES)) 
+            found[numfound++] = TestSolutionMask(s);
+        TestCheck(TestSameSolutions(all, count, found, numfound), "ClearAssumptions restores all solutions", p);
+    }
+    DeleteSolver(s);
+    // a limit in the middle of the optimization; it bounds the whole call, not each search
+    s = NewSolver(problem);
+    Limits limits = {0};
+    limits.propagations = propagations/2 + 1;
+    SetLimits(s, NULL, &limits);
+    result = Optimize(s, objectives, 2);
+    TestCheck(result == LIMIT_REACHED && s->gNumProp < propagations, "the call limits bound Optimize", p);
+    if (result == LIMIT_REACHED) {
+        ClearAssumptions(s);
+        SetLimits(s, NULL, NULL);
+        result = Optimize(s, objectives, 2);
+    }
+    int optimumok = (result == (count > 0 ? SOLUTION_FOUND : SEARCH_EXHAUSTED));
+    if (result == SOLUTION_FOUND) {
+        int mask = TestSolutionMask(s);
+        optimumok = TestObjectiveValue(&objectives[0], mask) == TestObjectiveValue(&objectives[0], optimal[0])
+            && TestObjectiveValue(&objectives[1], mask) == TestObjectiveValue(&objectives[1], optimal[0]);
+    }
+    TestCheck(optimumok, "Optimize after LIMIT_REACHED and ClearAssumptions finds the optimum", p);
+    DeleteSolver(s);
+    free(found);
+    free(optimal);
+}
+
+/* Runs the checks on CHECK_PROBLEMS generated problems.
+   Returns 1 if a check failed, 0 otherwise.
+*/
+int TestSelfCheck () {
+    // solutions of the search without limits, sorted
+    int* all = (int*)malloc((1 << CHECK_VARIABLES)*sizeof(int));
+    int p;
+    for (p=0;p<CHECK_PROBLEMS;p++) {
+        int* problem = NewCheckProblem();
+        int count = TestEnumerate(problem, all);
+        qsort(all, count, sizeof(int), TestCompareMasks);
+        TestCheckNumbers(problem, p);
+        TestCheckLimits(problem, p, all, count);
+        TestCheckEnumerate(problem, p, all, count);
+        TestCheckProjection(problem, p, all, count);
+        TestCheckOptimize(problem, p, all, count);
+        free(problem);
+    }
+    free(all);
+    printf("%d checks, %d failed\n", gNumberOfChecks, gNumberOfFailedChecks);
+    return gNumberOfFailedChecks > 0;
+}
+
 int main(int argc, char** argv) {
-   
+
+    // self checks
+    if (argc > 1 && strcmp(argv[1], "-s") == 0)
+        return TestSelfCheck();
+
+    // options
+    char* checkpointfilename = NULL;
+    int arg = 1;
+    if (argc > arg+1 && strcmp(argv[arg], "-c") == 0) {
+        checkpointfilename = argv[arg+1];
+        arg += 2;
+    }
+
     // open input; defaults to stdin
     FILE* input = stdin;
-    if (argc >=2) {
-        char* inputfilename = argv[1];
+    if (argc > arg) {
+        char* inputfilename = argv[arg];
         input = fopen(inputfilename, "rt");
         if (input == NULL) { 
             printf("failed to open file %s\n",inputfilename);
@@ -182,6 +648,7 @@ int main(int argc, char** argv) {
     }
 
     // ------- parse input stream ---------
+    ALLOC_PHASE("parse")
     int value;
     int state = 0;  // 0=new rule, new lhs, 1=add lhs, 2=new rhs, 3=add to rhs
     TestRule* newrule = NULL;
@@ -352,29 +819,73 @@ int main(int argc, char** argv) {
     array[index++] = 0;         // terminating zero
 
     // ---------- create solver and get solutions! -----
+    ALLOC_PHASE("solve")
 
     Solver* solver = NewSolver(array);
+
+    // resume from checkpoint and stop the search periodically to save a new one
+    double lastcheckpoint = 0.0;
+    if (checkpointfilename != NULL) {
+        FILE* checkpoint = fopen(checkpointfilename, "rt");
+        if (checkpoint != NULL) {
+            if (LoadSolverState(solver, checkpoint)) 
+                printf("Resumed from checkpoint %s\n", checkpointfilename);
+            else
+                printf("Ignored checkpoint %s; it does not match the problem\n", checkpointfilename);
+            fclose(checkpoint);
+        }
+        Limits limits = {0};
+        limits.seconds = CHECKPOINT_SECONDS;
+        SetLimits(solver, NULL, &limits);
+        lastcheckpoint = solver->gSeconds;
+    }
+
+    // layout of output numbers (rules with no rhs)
+    NumberLayout* layout = NewNumberLayout();
+    rule = gFirstTestRule;
+    while (rule != NULL) {
+        if (rule->rhs == NULL && rule->lhs != NULL) {
+            // count number of bits
+            int bitcount = 0;
+            TestNode* node = rule->lhs;
+            while (node != NULL) {
+                node = node -> next;
+                bitcount++;
+            }
+            // convert to array of literals
+            int* literals = (int*)malloc((bitcount+1)*sizeof(int));
+            bitcount = 0;
+            node = rule->lhs;
+            while (node != NULL) {
+                literals[bitcount++] = node->value;
+                node = node -> next;
+            }
+            literals[bitcount] = 0;
+            if (AddLayoutNumber(layout, literals, FALSE) < 0)
+                printf("output with %d bits ignored (max 64 bits)\n", bitcount);
+            free(literals);
+        }
+        rule = rule -> next;
+    }
+    int64_t* outputs = (int64_t*)malloc((layout->count+1)*sizeof(int64_t));
+
     int numSolutions = 0;
     int v;
-    while (NextSolution(solver)) {
+    int result;
+    while ((result = NextSolution(solver)) != SEARCH_EXHAUSTED) {
+        if (checkpointfilename != NULL && solver->gSeconds - lastcheckpoint >= CHECKPOINT_SECONDS) {
+            TestSaveCheckpoint(solver, checkpointfilename);
+            lastcheckpoint = solver->gSeconds;
+        }
+        if (result == LIMIT_REACHED) continue;
+        ALLOC_PHASE("output")
         numSolutions++;
         printf("Solution #%d:\n",numSolutions);
         // print output numbers (rules with no rhs)
-        TestRule* rule = gFirstTestRule;
-        int outputcount = 0;
-        while (rule != NULL) {
-            if (rule->rhs == NULL && rule->lhs != NULL) {
-                // count number of bits
-                int bitcount = 0;
-                TestNode* node = rule->lhs;
-                while (node != NULL) {
-                    node = node -> next;
-                    bitcount++;
-                }
-                // show 
-                printf("output #%d (%d bits) = %d\n",++outputcount, bitcount, TestGetNumber(solver,rule->lhs));
-            }
-            rule = rule -> next;
+        GetNumbers(solver, layout, outputs);
+        int outputcount;
+        for (outputcount=0;outputcount<layout->count;outputcount++) {
+            printf("output #%d (%d bits) = %lld\n", outputcount+1, layout->width[outputcount], (long long)outputs[outputcount]);
         }
         // print complete solution (if no output rules defined)
         if (outputcount == 0) {
@@ -389,6 +900,15 @@ int main(int argc, char** argv) {
         }
 
     }
+    ALLOC_PHASE("output")
     printf("%d solutions\n", numSolutions);
+    printf("%d propagations\n", solver->gNumProp);
+    printf("%d choices\n", solver->gNumChoice);
+    WritePerfCounters(solver, stdout);
+    DeleteNumberLayout(layout);
+    free(outputs);
+    // search complete
+    if (checkpointfilename != NULL) remove(checkpointfilename);
+    ALLOC_REPORT(stderr)
     return 0;
 }